@@ -76,11 +76,55 @@ namespace ClassGame {
                         ImGui::Text("%s", stateString.substr(y*stride,stride).c_str());
                     }
                     ImGui::Text("Current Board State: %s", game->stateString().c_str());
+
+                    // the AI searches on a background thread, show how far it has got
+                    if (game->aiThinking()) {
+                        ImGui::Separator();
+                        ImGui::Text("AI: %s", game->aiStatus().c_str());
+                        if (ImGui::Button("Stop and move now")) {
+                            game->stopAI();
+                        }
+                    }
                 }
                 ImGui::End();
 
+                // the AI's candidate moves, refreshed as each iteration of its search completes
+                if (game && game->gameHasAI()) {
+                    ImGui::Begin("Analysis");
+                    ImGui::SliderInt("Lines", &game->_gameOptions.AIMultiPV, 1, 8);
+                    std::vector<AILine> lines = game->aiLines();
+                    if (ImGui::BeginTable("AnalysisLines", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+                        ImGui::TableSetupColumn("#", ImGuiTableColumnFlags_WidthFixed);
+                        ImGui::TableSetupColumn("Score", ImGuiTableColumnFlags_WidthFixed);
+                        ImGui::TableSetupColumn("Depth", ImGuiTableColumnFlags_WidthFixed);
+                        ImGui::TableSetupColumn("Line", ImGuiTableColumnFlags_WidthStretch);
+                        ImGui::TableHeadersRow();
+                        for (size_t i = 0; i < lines.size(); i++) {
+                            const AILine& line = lines[i];
+                            ImGui::TableNextRow();
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%d", int(i + 1));
+                            ImGui::TableNextColumn();
+                            if (std::abs(line.score) >= ScoreMateInMaxPly) {
+                                int mateIn = (ScoreMate - std::abs(line.score) + 1) / 2;
+                                ImGui::Text("%s#%d", line.score > 0 ? "" : "-", mateIn);
+                            } else {
+                                ImGui::Text("%+.2f", line.score / 100.0);
+                            }
+                            ImGui::TableNextColumn();
+                            ImGui::Text("%d", line.depth);
+                            ImGui::TableNextColumn();
+                            ImGui::TextWrapped("%s", line.moves.c_str());
+                        }
+                        ImGui::EndTable();
+                    }
+                    ImGui::End();
+                }
+
                 ImGui::Begin("GameWindow");
                 if (game) {
+                    // games with a background AI return from updateAI at once and play their move on a
+                    // later frame, so a long search never holds up the render loop
                     if (game->gameHasAI() && (game->getCurrentPlayer()->isAIPlayer() || game->_gameOptions.AIvsAI))
                     {
                         game->updateAI();
@@ -0,0 +1,250 @@
+#include "Attacks.h"
+#include "BitBoard.h"
+#include <bit>
+
+#if defined(CHESS_SLIDERS_DISPATCH)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+bool slidersUsePext = false;
+#endif
+
+Magic bishopMagics[64];
+Magic rookMagics[64];
+uint64_t betweenTable[64][64];
+uint64_t lineTable[64][64];
+
+// Every blocker subset of every square gets its own slot (sum of 2^popcount(mask)).
+static uint64_t bishopTable[5248];
+static uint64_t rookTable[102400];
+
+// Slow reference attack generator, only used while building the tables.
+// Walks each direction one square at a time and stops on the first blocker.
+static uint64_t slidingAttack(const int directions[4][2], int square, uint64_t occupied)
+{
+    uint64_t attacks = 0;
+    int row = square / 8;
+    int col = square % 8;
+
+    for (int dir = 0; dir < 4; dir++) {
+        int r = row + directions[dir][0];
+        int c = col + directions[dir][1];
+
+        while (r >= 0 && r < 8 && c >= 0 && c < 8) {
+            uint64_t toSquareBit = 1ULL << (r * 8 + c);
+            attacks |= toSquareBit;
+            if (occupied & toSquareBit) {
+                break;
+            }
+            r += directions[dir][0];
+            c += directions[dir][1];
+        }
+    }
+    return attacks;
+}
+
+// xorshift64* - deterministic so every run finds the same magics
+static uint64_t nextRandom(uint64_t& state)
+{
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 2685821657736338717ULL;
+}
+
+// Magic candidates with few set bits work far more often
+static uint64_t sparseRandom(uint64_t& state)
+{
+    return nextRandom(state) & nextRandom(state) & nextRandom(state);
+}
+
+static unsigned magicIndex(const Magic& m, uint64_t occupied)
+{
+    return unsigned(((occupied & m.mask) * m.magic) >> m.shift);
+}
+
+// Finds masks, table slices and magics; the search fills the table in magic order
+static void initMagics(const int directions[4][2], Magic magics[64], uint64_t* table)
+{
+    uint64_t occupancy[4096];
+    uint64_t reference[4096];
+    int      epoch[4096] = {};
+    int      attempt = 0;
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+
+    for (int square = 0; square < 64; square++) {
+        Magic& m = magics[square];
+
+        // Board edges never block anything unless the slider is already on that edge
+        uint64_t rankMask = Rank1 << (8 * (square / 8));
+        uint64_t fileMask = FileA << (square % 8);
+        uint64_t edges = ((Rank1 | Rank8) & ~rankMask) | ((FileA | FileH) & ~fileMask);
+        m.mask = slidingAttack(directions, square, 0) & ~edges;
+        m.shift = 64 - std::popcount(m.mask);
+        m.attacks = square == 0 ? table : magics[square - 1].attacks + (1ULL << (64 - magics[square - 1].shift));
+
+        // Enumerate every subset of the mask (Carry-Rippler trick) with its true attack set
+        int size = 0;
+        uint64_t subset = 0;
+        do {
+            occupancy[size] = subset;
+            reference[size] = slidingAttack(directions, square, subset);
+            size++;
+            subset = (subset - m.mask) & m.mask;
+        } while (subset);
+
+        // Try random magics until every subset maps to a slot holding its own attack set.
+        // Two subsets sharing a slot is fine as long as their attacks are identical.
+        for (int i = 0; i < size; ) {
+            do {
+                m.magic = sparseRandom(seed);
+            } while (std::popcount((m.mask * m.magic) >> 56) < 6);
+
+            attempt++;
+            for (i = 0; i < size; i++) {
+                unsigned idx = magicIndex(m, occupancy[i]);
+                if (epoch[idx] < attempt) {
+                    epoch[idx] = attempt;
+                    m.attacks[idx] = reference[i];
+                } else if (m.attacks[idx] != reference[i]) {
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Lays the table out for the active backend. A PEXT index is the blocker bits packed
+// together, so each square's slice is exactly as large as its magic slice
+static void fillSliderTable(const int directions[4][2], Magic magics[64])
+{
+    for (int square = 0; square < 64; square++) {
+        Magic& m = magics[square];
+        uint64_t subset = 0;
+        do {
+            unsigned idx = slidersUsePext ? unsigned(parallelBitsExtract(subset, m.mask)) : magicIndex(m, subset);
+            m.attacks[idx] = slidingAttack(directions, square, subset);
+            subset = (subset - m.mask) & m.mask;
+        } while (subset);
+    }
+}
+
+static const int bishopDirections[4][2] = {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+static const int rookDirections[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+#if defined(CHESS_SLIDERS_DISPATCH)
+static void cpuid(unsigned leaf, unsigned regs[4])
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, int(leaf), 0);
+    for (int i = 0; i < 4; i++) {
+        regs[i] = unsigned(info[i]);
+    }
+#else
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static bool cpuHasBmi2()
+{
+    unsigned regs[4];
+    cpuid(0, regs);
+    if (regs[0] < 7) {
+        return false;
+    }
+    cpuid(7, regs);
+    return (regs[1] >> 8) & 1;   // EBX bit 8
+}
+
+// AMD before Zen 3 runs PEXT in microcode, many times slower than a magic multiply.
+// Hygon's Dhyana is a Zen 1 (family 0x18) and does the same
+static bool cpuHasFastPext()
+{
+    if (!cpuHasBmi2()) {
+        return false;
+    }
+    unsigned regs[4];
+    cpuid(0, regs);
+    bool amd = regs[1] == 0x68747541;   // "Auth"enticAMD
+    bool hygon = regs[1] == 0x6F677948; // "Hygo"nGenuine
+    if (!amd && !hygon) {
+        return true;
+    }
+    cpuid(1, regs);
+    unsigned family = (regs[0] >> 8) & 0xF;
+    if (family == 0xF) {
+        family += (regs[0] >> 20) & 0xFF;
+    }
+    return family >= 0x19;
+}
+#endif
+
+const char* sliderBackendName()
+{
+    return slidersUsePext ? "pext" : "magic";
+}
+
+bool selectSliderBackend(bool usePext)
+{
+#if defined(CHESS_SLIDERS_DISPATCH)
+    if (usePext && !cpuHasBmi2()) {
+        return false;
+    }
+    if (usePext != slidersUsePext) {
+        slidersUsePext = usePext;
+        fillSliderTable(bishopDirections, bishopMagics);
+        fillSliderTable(rookDirections, rookMagics);
+    }
+    return true;
+#else
+    return usePext == slidersUsePext;
+#endif
+}
+
+// the leaper tables really are compile-time constants
+static_assert(knightAttacks(0) == ((1ULL << 10) | (1ULL << 17)), "knight on a1 attacks c2 and b3");
+static_assert(pawnAttacks(0, 12) == ((1ULL << 19) | (1ULL << 21)), "white pawn on e2 attacks d3 and f3");
+
+// Needs the slider tables, so it runs after initMagics
+static void initLines()
+{
+    for (int a = 0; a < 64; a++) {
+        for (int b = 0; b < 64; b++) {
+            uint64_t bitA = 1ULL << a;
+            uint64_t bitB = 1ULL << b;
+            betweenTable[a][b] = 0;
+            lineTable[a][b] = 0;
+            if (a == b) {
+                continue;
+            }
+            if (bishopAttacks(a, 0) & bitB) {
+                betweenTable[a][b] = bishopAttacks(a, bitB) & bishopAttacks(b, bitA);
+                lineTable[a][b] = (bishopAttacks(a, 0) & bishopAttacks(b, 0)) | bitA | bitB;
+            } else if (rookAttacks(a, 0) & bitB) {
+                betweenTable[a][b] = rookAttacks(a, bitB) & rookAttacks(b, bitA);
+                lineTable[a][b] = (rookAttacks(a, 0) & rookAttacks(b, 0)) | bitA | bitB;
+            }
+        }
+    }
+}
+
+namespace {
+    struct AttackTablesInitializer {
+        AttackTablesInitializer() {
+            initMagics(bishopDirections, bishopMagics, bishopTable);
+            initMagics(rookDirections, rookMagics, rookTable);
+#if defined(CHESS_SLIDERS_DISPATCH)
+            slidersUsePext = cpuHasFastPext();
+#endif
+            if (slidersUsePext) {
+                fillSliderTable(bishopDirections, bishopMagics);
+                fillSliderTable(rookDirections, rookMagics);
+            }
+            initLines();
+        }
+    };
+    AttackTablesInitializer attackTablesInitializer;
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdint>
+
+//
+// precomputed attack tables for every piece type
+// squares are numbered row * 8 + column, so a1 = 0 and h8 = 63
+//
+
+//
+// Slider backends: portable magic multiplication, or BMI2 PEXT which extracts the
+// blocker bits directly. Both index the same tables, which are filled in the order of
+// whichever backend is active. The choice is made once at startup from CPUID, or fixed
+// at compile time with CHESS_SLIDERS_PEXT / CHESS_SLIDERS_MAGIC (see CMakeLists.txt)
+//
+#if defined(CHESS_SLIDERS_PEXT) || defined(__BMI2__)
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(CHESS_SLIDERS_PEXT)
+constexpr bool slidersUsePext = true;
+#elif defined(CHESS_SLIDERS_MAGIC) || !(defined(__x86_64__) || defined(_M_X64))
+constexpr bool slidersUsePext = false;
+#else
+#define CHESS_SLIDERS_DISPATCH 1
+extern bool slidersUsePext;
+#endif
+
+inline uint64_t parallelBitsExtract(uint64_t bits, uint64_t mask) {
+#if defined(CHESS_SLIDERS_PEXT) || defined(__BMI2__) || (defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64))
+    return _pext_u64(bits, mask);
+#elif defined(__x86_64__)
+    // the runtime-dispatched build is not compiled with -mbmi2, so emit the instruction
+    // directly; it is only ever reached after CPUID has confirmed BMI2
+    uint64_t result;
+    __asm__("pextq %2, %1, %0" : "=r"(result) : "r"(bits), "r"(mask));
+    return result;
+#else
+    uint64_t result = 0;
+    for (uint64_t bit = 1; mask; bit += bit, mask &= mask - 1) {
+        if (bits & mask & -mask) {
+            result |= bit;
+        }
+    }
+    return result;
+#endif
+}
+
+// A "fancy" magic bitboard entry: the relevant blockers of a square are multiplied by
+// a magic constant and the top bits of the product index straight into the attack table.
+struct Magic {
+    uint64_t    mask;       // squares whose occupancy can block the slider (edges removed)
+    uint64_t    magic;      // multiplier that hashes every blocker subset without harmful collisions
+    uint64_t*   attacks;    // this square's slice of the shared attack table
+    int         shift;      // 64 - popcount(mask)
+
+    unsigned index(uint64_t occupied) const {
+        if (slidersUsePext) {
+            return unsigned(parallelBitsExtract(occupied, mask));
+        }
+        return unsigned(((occupied & mask) * magic) >> shift);
+    }
+};
+
+extern Magic bishopMagics[64];
+extern Magic rookMagics[64];
+
+// Name of the active backend, "pext" or "magic"
+const char* sliderBackendName();
+// Switches backend and refills the tables; returns false if this build or CPU cannot.
+// Only call while no other thread is generating moves
+bool selectSliderBackend(bool usePext);
+
+// Tables are filled in by a static initializer in Attacks.cpp before main() runs,
+// so the lookups below never need an "is it initialized" branch.
+inline uint64_t bishopAttacks(int square, uint64_t occupied) {
+    const Magic& m = bishopMagics[square];
+    return m.attacks[m.index(occupied)];
+}
+
+inline uint64_t rookAttacks(int square, uint64_t occupied) {
+    const Magic& m = rookMagics[square];
+    return m.attacks[m.index(occupied)];
+}
+
+inline uint64_t queenAttacks(int square, uint64_t occupied) {
+    return bishopAttacks(square, occupied) | rookAttacks(square, occupied);
+}
+
+//
+// Leaper tables are built by the compiler and baked into the binary:
+// no runtime init, no "initialized yet?" branch, nothing to race on between threads
+//
+
+// Single step attacks from a list of (row, col) offsets, dropping anything off the board
+constexpr uint64_t leaperAttack(int square, const int (*offsets)[2], int count)
+{
+    int row = square / 8;
+    int col = square % 8;
+    uint64_t attacks = 0;
+
+    for (int i = 0; i < count; i++) {
+        int newRow = row + offsets[i][0];
+        int newCol = col + offsets[i][1];
+        if (newRow >= 0 && newRow < 8 && newCol >= 0 && newCol < 8) {
+            attacks |= 1ULL << (newRow * 8 + newCol);
+        }
+    }
+    return attacks;
+}
+
+struct LeaperTables {
+    uint64_t    knight[64];
+    uint64_t    king[64];
+    uint64_t    pawn[2][64];    // [color][square], squares a pawn of that color captures on
+};
+
+constexpr LeaperTables makeLeaperTables()
+{
+    const int knightOffsets[8][2] = {{-2, -1}, {-2, 1}, {-1, -2}, {-1, 2}, {1, -2}, {1, 2}, {2, -1}, {2, 1}};
+    const int kingOffsets[8][2] = {{-1, -1}, {-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}, {1, 1}};
+    const int whitePawnOffsets[2][2] = {{1, -1}, {1, 1}};   // white pawns move up the board
+    const int blackPawnOffsets[2][2] = {{-1, -1}, {-1, 1}};
+
+    LeaperTables tables{};
+    for (int square = 0; square < 64; square++) {
+        tables.knight[square] = leaperAttack(square, knightOffsets, 8);
+        tables.king[square] = leaperAttack(square, kingOffsets, 8);
+        tables.pawn[0][square] = leaperAttack(square, whitePawnOffsets, 2);
+        tables.pawn[1][square] = leaperAttack(square, blackPawnOffsets, 2);
+    }
+    return tables;
+}
+
+inline constexpr LeaperTables leaperTables = makeLeaperTables();
+
+constexpr uint64_t knightAttacks(int square) { return leaperTables.knight[square]; }
+constexpr uint64_t kingAttacks(int square) { return leaperTables.king[square]; }
+constexpr uint64_t pawnAttacks(int color, int square) { return leaperTables.pawn[color][square]; }
+
+// Geometry tables, filled in by the slider initializer since they are derived from it
+extern uint64_t betweenTable[64][64];      // squares strictly between two aligned squares
+extern uint64_t lineTable[64][64];         // whole rank/file/diagonal through two aligned squares
+
+// 0 when the squares do not share a rank, file or diagonal
+inline uint64_t betweenSquares(int a, int b) { return betweenTable[a][b]; }
+inline uint64_t lineThrough(int a, int b) { return lineTable[a][b]; }
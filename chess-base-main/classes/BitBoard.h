@@ -4,9 +4,26 @@
 #include <intrin.h>
 #endif
 #include <iostream>
+#include <cstdint>
 #include "ChessPiece.h"
 
 
+// Whole-board masks, squares are numbered row * 8 + column (a1 = 0, h8 = 63)
+constexpr uint64_t FileA = 0x0101010101010101ULL;
+constexpr uint64_t FileH = FileA << 7;
+constexpr uint64_t Rank1 = 0x00000000000000FFULL;
+constexpr uint64_t Rank3 = Rank1 << 16;
+constexpr uint64_t Rank6 = Rank1 << 40;
+constexpr uint64_t Rank8 = Rank1 << 56;
+
+// Move every bit one step in a direction, dropping whatever would wrap around a board edge
+// (up = towards rank 8, left = towards the a-file)
+constexpr uint64_t shiftUp(uint64_t bits) { return bits << 8; }
+constexpr uint64_t shiftDown(uint64_t bits) { return bits >> 8; }
+constexpr uint64_t shiftUpLeft(uint64_t bits) { return (bits & ~FileA) << 7; }
+constexpr uint64_t shiftUpRight(uint64_t bits) { return (bits & ~FileH) << 9; }
+constexpr uint64_t shiftDownLeft(uint64_t bits) { return (bits & ~FileA) >> 9; }
+constexpr uint64_t shiftDownRight(uint64_t bits) { return (bits & ~FileH) >> 7; }
 
 class BitBoard {
   public:
@@ -73,21 +90,39 @@ private:
 };
 
 
+// Extra information packed into BitMove::flags
+// the low three bits hold the ChessPiece a pawn promotes to (NoPiece otherwise)
+enum BitMoveFlags : uint8_t {
+    MovePromotionMask   = 0x07,
+    MoveCapture         = 0x08,
+    MoveEnPassant       = 0x10,
+    MoveCastle          = 0x20,
+    MoveDoublePush      = 0x40
+};
+
 // Bit Move is used to store movable positions 
 // so BitMove(startBitBoard, toBitBoard, chessPiece) -> is showing the possible moves for chessPiece
 struct BitMove {
     uint8_t from;
     uint8_t to;
     uint8_t piece;
+    uint8_t flags;
     
-    BitMove(int from, int to, ChessPiece piece)
-        : from(from), to(to), piece(piece) { }
+    BitMove(int from, int to, ChessPiece piece, int flags = 0)
+        : from(from), to(to), piece(piece), flags(flags) { }
         
-    BitMove() : from(0), to(0), piece(NoPiece) { }
+    // left trivial so fixed-size move arrays cost nothing to construct, BitMove{} is still all zero
+    BitMove() = default;
+    
+    ChessPiece promotion() const { return ChessPiece(flags & MovePromotionMask); }
+    bool isCapture() const { return flags & MoveCapture; }
+    bool isEnPassant() const { return flags & MoveEnPassant; }
+    bool isCastle() const { return flags & MoveCastle; }
     
     bool operator==(const BitMove& other) const {
         return from == other.from && 
                to == other.to && 
-               piece == other.piece;
+               piece == other.piece &&
+               flags == other.flags;
     }
-};
\ No newline at end of file
+};
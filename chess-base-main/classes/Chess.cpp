@@ -1,21 +1,35 @@
 #include "Chess.h"
+#include "Attacks.h"
+#include "MoveGen.h"
 #include <limits>
 #include <cmath>
 #include <iostream> // Added for debug output
 
-// Initialize static members
-BitBoard Chess::_knightBitboards[64];
-bool Chess::_knightBitboardsInitialized = false;
+// Weights for the network evaluation, looked for in the working directory
+static const char* NetworkFile = "chess.nnue";
 
 Chess::Chess()
+    : _search(_transpositionTable)
 {
     _grid = new Grid(8, 8);
     _selectedPiece = nullptr;
     _selectedPieceSource = nullptr;
+
+    _search.onIteration = [this](const SearchResult& progress) {
+        std::lock_guard<std::mutex> lock(_aiProgressMutex);
+        _aiProgress = progress;
+    };
+
+    if (_network.load(NetworkFile)) {
+        _search.network = &_network;
+        std::cout << "AI: evaluating with " << NetworkFile << " (" << _network.hiddenSize() << " hidden, "
+                  << networkKernelName() << ")" << std::endl;
+    }
 }
 
 Chess::~Chess()
 {
+    cancelAI();
     delete _grid;
     // Note: _selectedPiece and _selectedPieceSource are just pointers, don't delete
     _selectedPiece = nullptr;
@@ -63,73 +77,53 @@ void Chess::setUpBoard()
     _gameOptions.rowY = 8;
 
     _grid->initializeChessSquares(pieceSize, "boardsquare.png");
-    FENtoBoard("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR");
+    FENtoBoard("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+
+    // the AI plays black, searching a fixed depth unless a node or time limit is set
+    if (gameHasAI()) {
+        setAIPlayer(AI_PLAYER);
+        _gameOptions.AIDepthSearches = 5;
+        _gameOptions.AIMAXDepth = MaxPly - 1;
+        _gameOptions.AIHashMB = 64;
+        _gameOptions.AIThreads = 0;
+        _gameOptions.AIPonder = true;
+    }
+    _transpositionTable.clear();
+    _aiClocksSet = false;
 
     startGame();
 }
 
 void Chess::FENtoBoard(const std::string& fen) {
-    // Clear board - > nullptr
-    // row 7, col 0
-    // change col per /,
-    
     // convert a FEN string to a board
-    // FEN is a space delimited string with 6 fields
+    // FEN is a space delimited string with 6 fields, or just the first one:
     // 1: piece placement (from white's perspective)
-    //we want to loop through each char in fen and update on the board
-    // for now lets print first char fen[0]
-    // FEN FENtoBoard("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR");
-
-    auto getType = [](char c) -> int{
-            switch (c)
-            {
-                case 'p' : case 'P':
-                return 1;
-                case 'n': case 'N':
-                return 2;
-                case 'b': case 'B':
-                return 3;
-                case 'r': case 'R':
-                return 4;
-                case 'q': case 'Q':
-                return 5;
-                case 'k': case 'K':
-                return 6;
-            }
-        }; // 1 pawn, 2 Knignt, 3 Bishop, 4 Rook, 5 Queen, 6 King
-
-    int row = 7;
-    int col = 0;
-    for (char c : fen)
-    {
-        // if / we row-- and we col 0
-        if(c == '/')
-        {
-            row--;
-            col = 0;
-        }
-        else if(isdigit(c))
-        {
-            col += (int)c;
-        }
-        else
-        {
-            int playerType = getType(c);
-            int playerColor = isupper(c) ? 0 : 1; // white = 0, black = 1
-            Bit* currBit = PieceForPlayer(playerColor, ChessPiece(playerType));
-            BitHolder* holder = _grid->getSquare(col, row);
-            holder->setBit(currBit);
-            currBit->setPosition(holder->getPosition());
-            col++; // at the end we move to next column
-        }
-    }
-
-    // NOT PART OF THIS ASSIGNMENT BUT OTHER THINGS THAT CAN BE IN A FEN STRING
-    // ARE BELOW
     // 2: active color (W or B)
     // 3: castling availability (KQkq or -)
     // 4: en passant target square (in algebraic notation, or -)
     // 5: halfmove clock (number of halfmoves since the last capture or pawn advance)
+    // 6: fullmove number
+    // the headless position parses it, then the sprites are laid out from its mailbox. A FEN
+    // that does not parse leaves the board as it was
+    Position position;
+    if (!position.setFEN(fen)) {
+        std::cout << "FENtoBoard: invalid FEN " << fen << std::endl;
+        return;
+    }
+    _position = position;
+    _undoStack.clear();
+
+    for (int square = 0; square < 64; square++) {
+        ChessSquare* holder = _grid->getSquareByIndex(square);
+        uint8_t tag = _position.pieceOn(square);
+        if (!tag) {
+            holder->destroyBit();
+            continue;
+        }
+        Bit* currBit = PieceForPlayer(tagColor(tag), tagPiece(tag));
+        holder->setBit(currBit);
+        currBit->setPosition(holder->getPosition());
+    }
 }
 
 bool Chess::actionForEmptyHolder(BitHolder &holder)
@@ -187,7 +181,7 @@ bool Chess::canBitMoveFrom(Bit &bit, BitHolder &src)
     int currentPlayer = getCurrentPlayer()->playerNumber() * 128;
     std::cout << "Current Player" << currentPlayer << " + " << getCurrentTurnNo() << std::endl;
     int pieceColor = bit.gameTag() & 128;
-    if (pieceColor == currentPlayer) {
+    if (pieceColor == currentPlayer && !checkForDraw()) {
         // Highlight valid moves when piece is selected
         std::vector<BitMove>* validMoves = getValidMovesForPiece(bit, src);
         if (validMoves) {
@@ -231,6 +225,7 @@ bool Chess::canBitMoveFromTo(Bit &bit, BitHolder &src, BitHolder &dst)
 
 void Chess::stopGame()
 {
+    cancelAI();
     _grid->forEachSquare([](ChessSquare* square, int x, int y) {
         square->destroyBit();
     });
@@ -254,9 +249,10 @@ Player* Chess::checkForWinner()
     return nullptr;
 }
 
+// A game that has filled the undo stack is adjudicated a draw, nothing can be played after it
 bool Chess::checkForDraw()
 {
-    return false;
+    return _undoStack.full();
 }
 
 std::string Chess::initialStateString()
@@ -289,12 +285,6 @@ void Chess::setStateString(const std::string &s)
 
 std::vector<BitMove>* Chess::generatePossibleMoves(const MoveGenContext& context)
 {
-    // Initialize knight bitboards once
-    if (!_knightBitboardsInitialized) {
-        initializeKnightBitboards();
-        _knightBitboardsInitialized = true;
-    }
-    
     _cachedMoves.clear();
     
     // DEBUG: Add this
@@ -303,6 +293,8 @@ std::vector<BitMove>* Chess::generatePossibleMoves(const MoveGenContext& context
         case Pawn: std::cout << "Pawn"; break;
         case Knight: std::cout << "Knight"; break;
         case Bishop: std::cout << "Bishop"; break;
+        case Rook: std::cout << "Rook"; break;
+        case Queen: std::cout << "Queen"; break;
         case King: std::cout << "King"; break;
         default: std::cout << "Unknown(" << (int)context.pieceType << ")"; break;
     }
@@ -325,6 +317,12 @@ std::vector<BitMove>* Chess::generatePossibleMoves(const MoveGenContext& context
         case Bishop:
             generateBishopMoves(_cachedMoves, context.pieceBitboard, emptySpots.getData(), context.allPieces.getData(), enemyPieces.getData());
             break;
+        case Rook:
+            generateRookMoves(_cachedMoves, context.pieceBitboard, emptySpots.getData(), context.allPieces.getData(), enemyPieces.getData());
+            break;
+        case Queen:
+            generateQueenMoves(_cachedMoves, context.pieceBitboard, emptySpots.getData(), context.allPieces.getData(), enemyPieces.getData());
+            break;
         case King:
             generateKingMoves(_cachedMoves, context.pieceBitboard, emptySpots.getData(), enemyPieces.getData());
             break;
@@ -334,38 +332,11 @@ std::vector<BitMove>* Chess::generatePossibleMoves(const MoveGenContext& context
     return &_cachedMoves;
 }
 
-// Initialize precomputed knight move bitboards
-void Chess::initializeKnightBitboards() {
-    // Knight moves: (±1, ±2) and (±2, ±1)
-    int knightOffsets[8][2] = {
-        {-2, -1}, {-2, 1}, {-1, -2}, {-1, 2},
-        {1, -2}, {1, 2}, {2, -1}, {2, 1}
-    };
-    
-    for (int square = 0; square < 64; square++) {
-        int row = square / 8;
-        int col = square % 8;
-        uint64_t moves = 0;
-        
-        for (int i = 0; i < 8; i++) {
-            int newRow = row + knightOffsets[i][0];
-            int newCol = col + knightOffsets[i][1];
-            
-            if (newRow >= 0 && newRow < 8 && newCol >= 0 && newCol < 8) {
-                int targetSquare = newRow * 8 + newCol;
-                moves |= (1ULL << targetSquare);
-            }
-        }
-        
-        _knightBitboards[square] = BitBoard(moves);
-    }
-}
-
 // Generate knight moves
 void Chess::generateKnightMoves(std::vector<BitMove>& moves, BitBoard knightBoard, uint64_t emptySquares, uint64_t enemyPieces) {
     knightBoard.forEachBit([&](int fromSquare) {
-        // Get all possible knight moves from this square
-        uint64_t possibleMoves = _knightBitboards[fromSquare].getData();
+        // Get all possible knight moves from this square (compile-time table in Attacks.h)
+        uint64_t possibleMoves = knightAttacks(fromSquare);
         // Filter to only empty squares or enemy pieces (can't capture own pieces)
         uint64_t validTargets = possibleMoves & (emptySquares | enemyPieces);
         
@@ -377,164 +348,73 @@ void Chess::generateKnightMoves(std::vector<BitMove>& moves, BitBoard knightBoar
 }
 
 // Generate pawn moves
+// Set-wise: every push or capture direction is one shift of the whole pawn bitboard,
+// masked so pawns on the edge files cannot wrap, then the targets are bit-scanned
 void Chess::generatePawnMoves(std::vector<BitMove>& moves, BitBoard pawnBoard, uint64_t emptySquares, uint64_t enemyPieces, bool isWhite) {
-    pawnBoard.forEachBit([&](int fromSquare) {
-        int row = fromSquare / 8;
-        int col = fromSquare % 8;
-        
-        if (isWhite) {
-            // White pawns move UP (increasing row) towards row 7
-            // Forward one square
-            if (row < 7) {
-                int forwardOne = fromSquare + 8;  // Changed from -8 to +8
-                uint64_t forwardOneBit = 1ULL << forwardOne;
-                
-                if (emptySquares & forwardOneBit) {
-                    moves.emplace_back(fromSquare, forwardOne, Pawn);
-                    
-                    // Forward two squares from starting rank (row 1 = white's starting rank)
-                    if (row == 1) {  // Changed from row == 6
-                        int forwardTwo = fromSquare + 16;  // Changed from -16 to +16
-                        uint64_t forwardTwoBit = 1ULL << forwardTwo;
-                        if (emptySquares & forwardTwoBit) {
-                            moves.emplace_back(fromSquare, forwardTwo, Pawn);
-                        }
-                    }
-                }
-            }
-            
-            // Capture diagonally (left and right) - moving UP
-            if (row < 7) {  // Changed from row > 0
-                // Capture left (SW when moving up) - row + 1, col - 1
-                if (col > 0) {
-                    int captureLeft = fromSquare + 7;  // Changed from -9 to +7
-                    uint64_t captureLeftBit = 1ULL << captureLeft;
-                    if (enemyPieces & captureLeftBit) {
-                        moves.emplace_back(fromSquare, captureLeft, Pawn);
-                    }
-                }
-                // Capture right (SE when moving up) - row + 1, col + 1
-                if (col < 7) {
-                    int captureRight = fromSquare + 9;  // Changed from -7 to +9
-                    uint64_t captureRightBit = 1ULL << captureRight;
-                    if (enemyPieces & captureRightBit) {
-                        moves.emplace_back(fromSquare, captureRight, Pawn);
-                    }
-                }
-            }
-        } else {
-            // Black pawns move DOWN (decreasing row) towards row 0
-            // Forward one square
-            if (row > 0) {  // Changed from row < 7
-                int forwardOne = fromSquare - 8;  // Changed from +8 to -8
-                uint64_t forwardOneBit = 1ULL << forwardOne;
-                
-                if (emptySquares & forwardOneBit) {
-                    moves.emplace_back(fromSquare, forwardOne, Pawn);
-                    
-                    // Forward two squares from starting rank (row 6 = black's starting rank)
-                    if (row == 6) {  // Changed from row == 1
-                        int forwardTwo = fromSquare - 16;  // Changed from +16 to -16
-                        uint64_t forwardTwoBit = 1ULL << forwardTwo;
-                        if (emptySquares & forwardTwoBit) {
-                            moves.emplace_back(fromSquare, forwardTwo, Pawn);
-                        }
-                    }
-                }
-            }
-            
-            // Capture diagonally (left and right) - moving DOWN
-            if (row > 0) {  // Changed from row < 7
-                // Capture left (NW when moving down) - row - 1, col - 1
-                if (col > 0) {
-                    int captureLeft = fromSquare - 9;  // Changed from +7 to -9
-                    uint64_t captureLeftBit = 1ULL << captureLeft;
-                    if (enemyPieces & captureLeftBit) {
-                        moves.emplace_back(fromSquare, captureLeft, Pawn);
-                    }
-                }
-                // Capture right (NE when moving down) - row - 1, col + 1
-                if (col < 7) {
-                    int captureRight = fromSquare - 7;  // Changed from +9 to -7
-                    uint64_t captureRightBit = 1ULL << captureRight;
-                    if (enemyPieces & captureRightBit) {
-                        moves.emplace_back(fromSquare, captureRight, Pawn);
-                    }
-                }
-            }
-        }
-    });
+    uint64_t pawns = pawnBoard.getData();
+    
+    // White pawns move UP (increasing row) towards row 7, black pawns DOWN towards row 0
+    int forward = isWhite ? 8 : -8;
+    int captureLeft = isWhite ? 7 : -9;
+    int captureRight = isWhite ? 9 : -7;
+    
+    uint64_t forwardOne = (isWhite ? shiftUp(pawns) : shiftDown(pawns)) & emptySquares;
+    // Forward two squares from the starting rank: the single push landed on rank 3 (or 6)
+    uint64_t forwardTwo = isWhite ? shiftUp(forwardOne & Rank3) : shiftDown(forwardOne & Rank6);
+    forwardTwo &= emptySquares;
+    uint64_t leftCaptures = (isWhite ? shiftUpLeft(pawns) : shiftDownLeft(pawns)) & enemyPieces;
+    uint64_t rightCaptures = (isWhite ? shiftUpRight(pawns) : shiftDownRight(pawns)) & enemyPieces;
+    
+    auto addMoves = [&](uint64_t targets, int delta) {
+        BitBoard(targets).forEachBit([&](int toSquare) {
+            moves.emplace_back(toSquare - delta, toSquare, Pawn);
+        });
+    };
+    addMoves(forwardOne, forward);
+    addMoves(forwardTwo, 2 * forward);
+    addMoves(leftCaptures, captureLeft);
+    addMoves(rightCaptures, captureRight);
 }
 
 // Generate bishop moves (sliding piece)
+// Attacks come from the magic tables in Attacks.h: one multiply, shift and lookup per bishop
 void Chess::generateBishopMoves(std::vector<BitMove>& moves, BitBoard bishopBoard, uint64_t emptySquares, uint64_t allPieces, uint64_t enemyPieces) {
-    // Diagonal directions: NW, NE, SW, SE
-    int directions[4][2] = {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
-    
     bishopBoard.forEachBit([&](int fromSquare) {
-        int row = fromSquare / 8;
-        int col = fromSquare % 8;
-        
-        // Slide in each of the 4 diagonal directions
-        for (int dir = 0; dir < 4; dir++) {
-            int r = row + directions[dir][0];
-            int c = col + directions[dir][1];
-            
-            while (r >= 0 && r < 8 && c >= 0 && c < 8) {
-                int toSquare = r * 8 + c;
-                uint64_t toSquareBit = 1ULL << toSquare;
-                
-                // Can move to this square (empty or enemy)
-                if (emptySquares & toSquareBit) {
-                    moves.emplace_back(fromSquare, toSquare, Bishop);
-                } else if (enemyPieces & toSquareBit) {
-                    // Can capture enemy piece, then stop
-                    moves.emplace_back(fromSquare, toSquare, Bishop);
-                    break;
-                } else {
-                    // Hit own piece or blocked, stop
-                    break;
-                }
-                
-                // Stop if we hit any piece
-                if (allPieces & toSquareBit) {
-                    break;
-                }
-                
-                r += directions[dir][0];
-                c += directions[dir][1];
-            }
-        }
+        BitBoard validTargets(bishopAttacks(fromSquare, allPieces) & (emptySquares | enemyPieces));
+        validTargets.forEachBit([&](int toSquare) {
+            moves.emplace_back(fromSquare, toSquare, Bishop);
+        });
+    });
+}
+
+// Generate rook moves (sliding piece)
+void Chess::generateRookMoves(std::vector<BitMove>& moves, BitBoard rookBoard, uint64_t emptySquares, uint64_t allPieces, uint64_t enemyPieces) {
+    rookBoard.forEachBit([&](int fromSquare) {
+        BitBoard validTargets(rookAttacks(fromSquare, allPieces) & (emptySquares | enemyPieces));
+        validTargets.forEachBit([&](int toSquare) {
+            moves.emplace_back(fromSquare, toSquare, Rook);
+        });
+    });
+}
+
+// Generate queen moves (bishop + rook attacks from the same square)
+void Chess::generateQueenMoves(std::vector<BitMove>& moves, BitBoard queenBoard, uint64_t emptySquares, uint64_t allPieces, uint64_t enemyPieces) {
+    queenBoard.forEachBit([&](int fromSquare) {
+        BitBoard validTargets(queenAttacks(fromSquare, allPieces) & (emptySquares | enemyPieces));
+        validTargets.forEachBit([&](int toSquare) {
+            moves.emplace_back(fromSquare, toSquare, Queen);
+        });
     });
 }
 
 // Generate king moves
 void Chess::generateKingMoves(std::vector<BitMove>& moves, BitBoard kingBoard, uint64_t emptySquares, uint64_t enemyPieces) {
-    // King moves one square in any direction (8 directions)
-    int kingOffsets[8][2] = {
-        {-1, -1}, {-1, 0}, {-1, 1},
-        {0, -1},           {0, 1},
-        {1, -1},  {1, 0},  {1, 1}
-    };
-    
     kingBoard.forEachBit([&](int fromSquare) {
-        int row = fromSquare / 8;
-        int col = fromSquare % 8;
-        
-        for (int i = 0; i < 8; i++) {
-            int newRow = row + kingOffsets[i][0];
-            int newCol = col + kingOffsets[i][1];
-            
-            if (newRow >= 0 && newRow < 8 && newCol >= 0 && newCol < 8) {
-                int toSquare = newRow * 8 + newCol;
-                uint64_t toSquareBit = 1ULL << toSquare;
-                
-                // Can move to empty square or capture enemy piece
-                if ((emptySquares & toSquareBit) || (enemyPieces & toSquareBit)) {
-                    moves.emplace_back(fromSquare, toSquare, King);
-                }
-            }
-        }
+        // Can move to empty square or capture enemy piece
+        BitBoard validTargets(kingAttacks(fromSquare) & (emptySquares | enemyPieces));
+        validTargets.forEachBit([&](int toSquare) {
+            moves.emplace_back(fromSquare, toSquare, King);
+        });
     });
 }
 
@@ -568,64 +448,49 @@ int Chess::getSquareIndex(BitHolder& holder) const {
     return -1;
 }
 
-// Helper: Build bitboards for current board state, excluding a specific piece
-void Chess::buildBitboards(BitBoard& whitePieces, BitBoard& blackPieces, BitBoard& allPieces, int excludeSquare) {
-    whitePieces.setData(0);
-    blackPieces.setData(0);
-    
-    _grid->forEachSquare([&](ChessSquare* square, int x, int y) {
-        Bit* bit = square->bit();
-        if (bit) {
-            int squareIndex = square->getSquareIndex();
-            
-            // Skip the excluded square (the piece we're moving)
-            if (squareIndex == excludeSquare) {
-                return;
-            }
-            
-            uint64_t squareBit = 1ULL << squareIndex;
-            
-            if (bit->gameTag() < 128) {
-                // White piece
-                whitePieces.setData(whitePieces.getData() | squareBit);
-            } else {
-                // Black piece
-                blackPieces.setData(blackPieces.getData() | squareBit);
-            }
-        }
-    });
-    
-    allPieces.setData(whitePieces.getData() | blackPieces.getData());
-}
-
 // Helper: Get valid moves for a specific piece
+// reads the headless _position, so no sprite is visited on clicks or drag-hovers
 std::vector<BitMove>* Chess::getValidMovesForPiece(Bit& bit, BitHolder& src) {
     int fromSquare = getSquareIndex(src);
     if (fromSquare < 0 || fromSquare >= 64) {
         return nullptr;
     }
     
-    // Build bitboards, excluding the piece we're moving
-    BitBoard whitePieces, blackPieces, allPieces;
-    buildBitboards(whitePieces, blackPieces, allPieces, fromSquare);
-    
     // Determine if this is a white or black piece
     bool isWhite = bit.gameTag() < 128;
+    int color = isWhite ? White : Black;
     
-    // Create bitboard for this specific piece
-    uint64_t pieceBit = 1ULL << fromSquare;
-    BitBoard pieceBitboard(pieceBit);
+    _cachedMoves.clear();
+    if (color != _position.sideToMove) {
+        return &_cachedMoves;
+    }
     
-    // Get piece type
-    ChessPiece pieceType = getPieceType(bit);
+    // The legal generator needs a king to test checks and pins against;
+    // practice boards without one fall back to the pseudo-legal generators
+    if (_position.pieces[color][King]) {
+        MoveList legalMoves;
+        generateLegalMoves(_position, legalMoves);
+        
+        for (const BitMove& move : legalMoves) {
+            if (move.from == fromSquare) {
+                _cachedMoves.push_back(move);
+            }
+        }
+        return &_cachedMoves;
+    }
+    
+    // Bitboards excluding the piece we're moving
+    uint64_t pieceBit = 1ULL << fromSquare;
+    BitBoard whitePieces(_position.colorPieces(White) & ~pieceBit);
+    BitBoard blackPieces(_position.colorPieces(Black) & ~pieceBit);
     
     // Create move generation context
     MoveGenContext context;
-    context.pieceBitboard = pieceBitboard;
+    context.pieceBitboard = BitBoard(pieceBit);
     context.whitePieces = whitePieces;
     context.blackPieces = blackPieces;
-    context.allPieces = allPieces;
-    context.pieceType = pieceType;
+    context.allPieces = BitBoard(whitePieces.getData() | blackPieces.getData());
+    context.pieceType = getPieceType(bit);
     context.isWhitePlayer = isWhite;
     
     // Generate moves
@@ -641,11 +506,35 @@ void Chess::clearBoardHighlights()
 
 void Chess::bitMovedFromTo(Bit &bit, BitHolder &src, BitHolder &dst)
 {
-    // // Verify the move was legal (double-check)
-    // if (!canBitMoveFromTo(bit, src, dst)) {
-    //     // Move was invalid, this shouldn't happen but handle it
-    //     return;
-    // }
+    int fromSquare = getSquareIndex(src);
+    int toSquare = getSquareIndex(dst);
+    
+    // Find the full move (flags, promotion) behind this from/to pair;
+    // promotions list the queen first, which is what the board promotes to
+    MoveList legalMoves;
+    generateLegalMoves(_position, legalMoves);
+    const BitMove* played = nullptr;
+    for (const BitMove& move : legalMoves) {
+        if (move.from == fromSquare && move.to == toSquare) {
+            played = &move;
+            break;
+        }
+    }
+    
+    if (played) {
+        playMove(*played);
+        // the reply the AI was pondering on turns its ponder search into its real one
+        if (_aiPondering) {
+            if (_aiPosition.key == _position.key) {
+                _aiPondering = false;
+                _aiPonderHit = true;
+            } else {
+                cancelAI();
+            }
+        }
+    } else {
+        std::cout << "bitMovedFromTo: no legal move from " << fromSquare << " to " << toSquare << std::endl;
+    }
     
     // Clear highlights
     clearBoardHighlights();
@@ -658,6 +547,234 @@ void Chess::bitMovedFromTo(Bit &bit, BitHolder &src, BitHolder &dst)
     //Game::bitMovedFromTo(bit, src, dst);
 }
 
+// The moved piece's sprite is already on its destination,
+// this fixes up the sprites a special move also touches and plays the move on _position
+void Chess::playMove(const BitMove& move)
+{
+    if (move.isCastle()) {
+        bool kingside = move.to > move.from;
+        ChessSquare* rookSrc = _grid->getSquareByIndex(kingside ? move.from + 3 : move.from - 4);
+        ChessSquare* rookDst = _grid->getSquareByIndex(kingside ? move.from + 1 : move.from - 1);
+        Bit* rook = rookSrc->bit();
+        if (rook && rookDst->dropBitAtPoint(rook, rookDst->getPosition())) {
+            rook->setPosition(rookDst->getPosition());
+            rookSrc->draggedBitTo(rook, rookDst);
+        }
+    }
+    if (move.isEnPassant()) {
+        int capturedSquare = move.to + (_position.sideToMove == White ? -8 : 8);
+        _grid->getSquareByIndex(capturedSquare)->destroyBit();
+    }
+    if (move.promotion()) {
+        ChessSquare* dst = _grid->getSquareByIndex(move.to);
+        Bit* promoted = PieceForPlayer(_position.sideToMove, move.promotion());
+        dst->setBit(promoted);
+        promoted->setPosition(dst->getPosition());
+    }
+    
+    // Keep the headless position in step with the board
+    _position.makeMove(move, _undoStack.push());
+}
+
+//
+// called every frame while it is the AI's turn, so it must never block:
+// the first call starts a search of the headless position on a background thread,
+// later calls return straight away until it is done, then play its move on the board
+// depth comes from the game options, a node or time limit can stop it sooner
+//
+void Chess::updateAI()
+{
+    // a ponder search the opponent's move did not match has no business on this turn
+    if (_aiPondering) {
+        cancelAI();
+    }
+    if (_aiRunning) {
+        if (!_aiDone.load(std::memory_order_acquire)) {
+            return;
+        }
+        _aiThread.join();
+        _aiRunning = false;
+        playAIMove(_aiResult.bestMove);
+        return;
+    }
+
+    MoveList legalMoves;
+    generateLegalMoves(_position, legalMoves);
+    if (legalMoves.empty() || checkForDraw()) {
+        return;     // the game is over
+    }
+
+    SearchLimits limits = aiLimits(_position.sideToMove);
+
+    // safe to reconfigure, no search is running
+    if (_gameOptions.AIHashMB > 0 && _gameOptions.AIHashMB != _transpositionTable.sizeMB()) {
+        _transpositionTable.resize(_gameOptions.AIHashMB);
+    }
+    _search.setThreads(_gameOptions.AIThreads);
+
+    _aiPosition = _position;
+    _aiHistory = _undoStack;
+    startAI(limits);
+}
+
+// The limits the game options give color's next move
+SearchLimits Chess::aiLimits(int color)
+{
+    if (!_aiClocksSet) {
+        for (TimeControl& clock : _aiClocks) {
+            clock.timeLeftMs = _gameOptions.AIClockMs;
+            clock.incrementMs = _gameOptions.AIIncrementMs;
+            clock.movesToGo = _gameOptions.AIMovesToGo;
+        }
+        _aiClocksSet = true;
+    }
+
+    SearchLimits limits;
+    int maxDepth = _gameOptions.AIMAXDepth > 0 ? std::min(_gameOptions.AIMAXDepth, MaxPly - 1) : MaxPly - 1;
+    limits.depth = _gameOptions.AIDepthSearches > 0 ? std::min(_gameOptions.AIDepthSearches, maxDepth) : maxDepth;
+    limits.nodes = _gameOptions.AINodeLimit;
+    limits.moveTimeMs = _gameOptions.AIMoveTimeMs;
+    limits.clock = _aiClocks[color];
+    limits.multiPV = std::max(1, _gameOptions.AIMultiPV);
+    // with nothing else to stop it an unlimited search would only end on a stop request
+    if (!_gameOptions.AIDepthSearches && !limits.nodes && !limits.moveTimeMs && !limits.clock.timeLeftMs) {
+        limits.depth = std::min(maxDepth, 5);
+    }
+    limits.stopRequest = &_aiStop;
+    return limits;
+}
+
+// Runs the search on _aiPosition in the background
+void Chess::startAI(const SearchLimits& limits)
+{
+    _aiProgress = SearchResult();
+    _aiStop = false;
+    _aiDone = false;
+    _aiRunning = true;
+    _aiThread = std::thread([this, limits]() {
+        _aiResult = _search.think(_aiPosition, limits, &_aiHistory);
+        _aiDone.store(true, std::memory_order_release);
+    });
+}
+
+// Moves the sprite for a move the AI chose, then plays it like a human move
+void Chess::playAIMove(const BitMove& move)
+{
+    if (move == BitMove{}) {
+        return;
+    }
+    const int color = _position.sideToMove;
+    std::cout << "AI: " << moveToString(move) << " depth " << _aiResult.depth << " score " << _aiResult.score
+              << " nodes " << _aiResult.nodes << " time " << _aiResult.timeMs << "ms";
+    if (_aiResult.pawnProbes) {
+        std::cout << " pawn hits " << 100 * _aiResult.pawnHits / _aiResult.pawnProbes << "%";
+    }
+    std::cout << std::endl;
+
+    ChessSquare* src = _grid->getSquareByIndex(move.from);
+    ChessSquare* dst = _grid->getSquareByIndex(move.to);
+    Bit* bit = src->bit();
+    if (!bit || !dst->dropBitAtPoint(bit, dst->getPosition())) {
+        return;
+    }
+    bit->setPosition(dst->getPosition());
+    src->draggedBitTo(bit, dst);
+
+    playMove(move);
+    clearBoardHighlights();
+    _gameOptions.currentTurnNo++;
+
+    // a pondered move's clock only ran from the moment the opponent replied
+    TimeControl& clock = _aiClocks[color];
+    if (clock.timeLeftMs > 0) {
+        clock.timeLeftMs = std::max(1, clock.timeLeftMs - _aiResult.timeMs) + clock.incrementMs;
+        // the last move of a time control brings the next one's time
+        if (clock.movesToGo > 0 && --clock.movesToGo == 0) {
+            clock.timeLeftMs += _gameOptions.AIClockMs;
+            clock.movesToGo = _gameOptions.AIMovesToGo;
+        }
+    }
+
+    if (_gameOptions.AIPonder && !_gameOptions.AIvsAI) {
+        startPondering();
+    }
+}
+
+// Plays the reply the search expects on a copy of the game and searches the position that
+// leaves, under the same limits the next move will get, which only start once it is played
+void Chess::startPondering()
+{
+    if (_aiResult.pvLength < 2 || _undoStack.full() || !isLegalMove(_position, _aiResult.pv[1])) {
+        return;
+    }
+    _aiPosition = _position;
+    _aiHistory = _undoStack;
+    _aiPosition.makeMove(_aiResult.pv[1], _aiHistory.push());
+
+    SearchLimits limits = aiLimits(_aiPosition.sideToMove);
+    limits.ponderHit = &_aiPonderHit;
+
+    _aiPonderHit = false;
+    _aiPondering = true;
+    startAI(limits);
+}
+
+// Stops a running search and throws its move away, before the board it was searching goes
+void Chess::cancelAI()
+{
+    if (!_aiRunning) {
+        return;
+    }
+    _aiStop = true;
+    _aiThread.join();
+    _aiRunning = false;
+    _aiPondering = false;
+}
+
+std::string Chess::aiStatus()
+{
+    if (!_aiRunning) {
+        return "";
+    }
+    SearchResult progress;
+    {
+        std::lock_guard<std::mutex> lock(_aiProgressMutex);
+        progress = _aiProgress;
+    }
+    if (!progress.depth) {
+        return "thinking...";
+    }
+
+    std::string status = "depth " + std::to_string(progress.depth) + "  score " + std::to_string(progress.score)
+                       + "  nodes " + std::to_string(progress.nodes) + "  " + std::to_string(progress.timeMs) + "ms\npv";
+    for (int i = 0; i < progress.pvLength; i++) {
+        status += " " + moveToString(progress.pv[i]);
+    }
+    return status;
+}
+
+std::vector<AILine> Chess::aiLines()
+{
+    std::vector<SearchLine> lines;
+    if (_aiRunning) {
+        std::lock_guard<std::mutex> lock(_aiProgressMutex);
+        lines = _aiProgress.lines;
+    } else {
+        lines = _aiResult.lines;
+    }
+
+    std::vector<AILine> display;
+    for (const SearchLine& line : lines) {
+        AILine& shown = display.emplace_back();
+        shown.score = line.score;
+        shown.depth = line.depth;
+        for (int i = 0; i < line.pvLength; i++) {
+            shown.moves += (i ? " " : "") + moveToString(line.pv[i]);
+        }
+    }
+    return display;
+}
+
 bool Chess::clickedBit(Bit &bit)
 {
     // Get the holder this piece is in
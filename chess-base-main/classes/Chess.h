@@ -3,6 +3,9 @@
 #include "Game.h"
 #include "Grid.h"
 #include "BitBoard.h"
+#include "Position.h"
+#include "Search.h"
+#include <mutex>
 
 
 constexpr int pieceSize = 80;
@@ -36,17 +39,27 @@ public:
     
     void bitMovedFromTo(Bit &bit, BitHolder &src, BitHolder &dst) override;
 
+    bool gameHasAI() override { return true; }
+    void updateAI() override;
+    bool aiThinking() override { return _aiRunning && !_aiPondering; }
+    void stopAI() override { _aiStop = true; }
+    std::string aiStatus() override;
+    std::vector<AILine> aiLines() override;
+
     std::string initialStateString() override;
     std::string stateString() override;
     void setStateString(const std::string &s) override;
 
     Grid* getGrid() override { return _grid; }
+    const Position& position() const { return _position; }
     
     // generating moves
     std::vector<BitMove>* generatePossibleMoves(const MoveGenContext& context);
     void generateKnightMoves(std::vector<BitMove>& moves, BitBoard knightBoard, uint64_t emptySquares, uint64_t enemyPieces);
     void generatePawnMoves(std::vector<BitMove>& moves, BitBoard pawnBoard, uint64_t emptySquares, uint64_t enemyPieces, bool isWhite);
     void generateBishopMoves(std::vector<BitMove>& moves, BitBoard bishopBoard, uint64_t emptySquares, uint64_t allPieces, uint64_t enemyPieces);
+    void generateRookMoves(std::vector<BitMove>& moves, BitBoard rookBoard, uint64_t emptySquares, uint64_t allPieces, uint64_t enemyPieces);
+    void generateQueenMoves(std::vector<BitMove>& moves, BitBoard queenBoard, uint64_t emptySquares, uint64_t allPieces, uint64_t enemyPieces);
     void generateKingMoves(std::vector<BitMove>& moves, BitBoard kingBoard, uint64_t emptySquares, uint64_t enemyPieces);
 
     
@@ -57,21 +70,52 @@ private:
     void FENtoBoard(const std::string& fen);
     char pieceNotation(int x, int y) const;
 
-     // Precomputed knight move bitboards
-     static BitBoard _knightBitboards[64];
-     static bool _knightBitboardsInitialized;
-     static void initializeKnightBitboards();
-
     // Helper methods for move generation
-    void buildBitboards(BitBoard& whitePieces, BitBoard& blackPieces, BitBoard& allPieces, int excludeSquare = -1);
     ChessPiece getPieceType(const Bit& bit) const;
     int getSquareIndex(BitHolder& holder) const;
     std::vector<BitMove>* getValidMovesForPiece(Bit& bit, BitHolder& src);
+    void playMove(const BitMove& move);
+    SearchLimits aiLimits(int color);
+    void startAI(const SearchLimits& limits);
+    void playAIMove(const BitMove& move);
+    void startPondering();
+    void cancelAI();
     void clearBoardHighlights() override;
 
     // Cache for move generation
     std::vector<BitMove> _cachedMoves;
     
+    // Headless copy of the board, updated move by move in bitMovedFromTo
+    Position _position;
+    UndoStack _undoStack;
+    
+    // The AI's search, the table is kept from move to move and cleared for each new game
+    TranspositionTable _transpositionTable;
+    Search _search;
+    Network _network;                   // used instead of the hand-written evaluation when its file loads
+    
+    // Background AI: the search runs on _aiThread against its own copy of the game, the main
+    // thread polls it once a frame in updateAI and plays the move there once it is done
+    std::thread _aiThread;
+    bool _aiRunning = false;            // main thread only
+    std::atomic<bool> _aiDone{false};   // set by the search thread once _aiResult is written
+    std::atomic<bool> _aiStop{false};
+    Position _aiPosition;
+    UndoStack _aiHistory;
+    SearchResult _aiResult;
+    std::mutex _aiProgressMutex;
+    SearchResult _aiProgress;           // last iteration the search reported
+
+    // Pondering: after its move the AI goes on searching the position its expected reply would
+    // give. If the opponent plays it the search carries on as the AI's next search, if not it is dropped
+    bool _aiPondering = false;          // main thread only, the running search is a ponder search
+    std::atomic<bool> _aiPonderHit{false};
+
+    // Each color's clock under the AIClockMs / AIIncrementMs / AIMovesToGo time control, filled
+    // in from the options on the first timed move of a game and run down by that color's moves
+    TimeControl _aiClocks[2];
+    bool _aiClocksSet = false;
+    
     // Click-and-drop selection tracking
     Bit* _selectedPiece;
     BitHolder* _selectedPieceSource;
@@ -0,0 +1,37 @@
+#include "Evaluate.h"
+#include <algorithm>
+
+// Tapered evaluation: Position keeps the piece-square midgame and endgame sums up to date
+// as pieces move, the pawn structure and imbalance terms come from their tables, and the two
+// are blended by how much material is left once the material table has scaled down endgames
+// the side ahead cannot win.
+// Promotions can push the phase past MaxPhase, which still counts as a full midgame
+int evaluate(const Position& position, PawnTable* pawns, MaterialTable* material)
+{
+    MaterialEntry computedMaterial;
+    const MaterialEntry* materialEntry = &computedMaterial;
+    if (material) {
+        materialEntry = &material->probe(position);
+    } else {
+        analyseMaterial(position, computedMaterial);
+    }
+    if (materialEntry->evaluator) {
+        return materialEntry->evaluate(position);
+    }
+
+    PawnEntry computed;
+    const PawnEntry* entry = &computed;
+    if (pawns) {
+        entry = &pawns->probe(position);
+    } else {
+        analysePawns(position, computed);
+    }
+
+    const int midgame = position.midgame + entry->midgame + materialEntry->midgame
+                      + kingShieldPawns(position, *entry) * KingShieldPawn;
+    int endgame = position.endgame + entry->endgame + materialEntry->endgame;
+    endgame = endgame * materialEntry->scale(position, endgame > 0 ? White : Black) / ScaleNormal;
+    const int phase = std::min(int(position.phase), MaxPhase);
+    const int score = (midgame * phase + endgame * (MaxPhase - phase)) / MaxPhase;
+    return position.sideToMove == White ? score : -score;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Material.h"
+#include "Pawns.h"
+
+//
+// static evaluation of a headless Position, in centipawns from the side to move's point of view
+//
+
+// Material values indexed by ChessPiece, the king is never traded so it has none.
+// Used by move ordering and pruning, the evaluation itself uses EvalWeights.h
+constexpr int PieceValue[7] = { 0, 100, 320, 330, 500, 900, 0 };
+
+// pawns and material cache the pawn structure and material terms; without them they are
+// worked out on every call. Endgames with a known answer skip the generic evaluation entirely
+int evaluate(const Position& position, PawnTable* pawns = nullptr, MaterialTable* material = nullptr);
@@ -16,6 +16,16 @@ Game::Game()
 	_gameOptions.rowY = 0;
 	_gameOptions.score = 0;
 	_gameOptions.AIDepthSearches = 0;
+	_gameOptions.AIMAXDepth = 0;
+	_gameOptions.AINodeLimit = 0;
+	_gameOptions.AIMoveTimeMs = 0;
+	_gameOptions.AIClockMs = 0;
+	_gameOptions.AIIncrementMs = 0;
+	_gameOptions.AIMovesToGo = 0;
+	_gameOptions.AIHashMB = 0;
+	_gameOptions.AIThreads = 1;
+	_gameOptions.AIPonder = false;
+	_gameOptions.AIMultiPV = 1;
 	_gameOptions.AIvsAI = false;
 
 	_table = nullptr;
@@ -29,6 +29,14 @@ const int HUMAN_PLAYER = -1;
 
 class GameTable;
 
+// One of the AI's candidate moves, for the analysis panel
+struct AILine
+{
+	int score;					// centipawns for the side to move
+	int depth;
+	std::string moves;			// the line, space separated
+};
+
 struct GameOptions
 {
 	bool AIPlaying;
@@ -39,8 +47,17 @@ struct GameOptions
 	int gameNumber;
 	unsigned int currentTurnNo;
 	int score;
-	int AIDepthSearches;
-	int AIMAXDepth;
+	int AIDepthSearches;		// depth the AI searches each move to, 0 = as deep as the other limits allow
+	int AIMAXDepth;				// no search goes deeper than this
+	uint64_t AINodeLimit;		// 0 = no limit
+	int AIMoveTimeMs;			// 0 = no limit
+	int AIClockMs;				// time on each AI's clock at the start and at every time control, 0 = untimed
+	int AIIncrementMs;			// added to an AI's clock after each of its moves
+	int AIMovesToGo;			// moves per time control, 0 = the clock is for the whole game
+	int AIHashMB;				// transposition table size
+	int AIThreads;				// search threads, 0 = one per core
+	bool AIPonder;				// search the expected reply while the opponent thinks
+	int AIMultiPV;				// best root moves the AI reports a line for, 1 = just its move
 	bool AIvsAI;
 };
 
@@ -97,6 +114,14 @@ public:
 	virtual void updateAI();
 	virtual void pieceTaken(Bit *bit){};
 
+	// for games whose AI thinks on a background thread: updateAI() then only starts the
+	// search and picks up its move on a later frame, these let the UI follow and stop it
+	virtual bool aiThinking() { return false; }
+	virtual void stopAI() {}
+	virtual std::string aiStatus() { return ""; }
+	// the AI's best lines from its current or last search, best first
+	virtual std::vector<AILine> aiLines() { return {}; }
+
 	virtual std::string initialStateString() = 0;
 	virtual std::string stateString() = 0;
 	virtual void setStateString(const std::string &s) = 0;
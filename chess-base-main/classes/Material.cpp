@@ -0,0 +1,343 @@
+#include "Material.h"
+#include "EvalWeights.h"
+#include "MoveGen.h"
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+
+constexpr uint64_t DarkSquares = 0xAA55AA55AA55AA55ULL;
+
+static int distance(int a, int b)
+{
+    return std::max(std::abs(a / 8 - b / 8), std::abs(a % 8 - b % 8));
+}
+
+// Grows towards the edges, 0 on the four centre squares and 120 in the corners
+static int pushToEdge(int square)
+{
+    const int row = square / 8;
+    const int col = square % 8;
+    return 20 * (std::max(3 - row, row - 4) + std::max(3 - col, col - 4));
+}
+
+// Grows as the two kings come together
+static int pushClose(int a, int b)
+{
+    return 140 - 20 * distance(a, b);
+}
+
+// Squares as strongSide sees them, its own first rank at the bottom
+static int relativeSquare(int square, int strongSide)
+{
+    return strongSide == White ? square : square ^ 56;
+}
+
+static int count(const Position& position, int color, ChessPiece piece)
+{
+    return materialCount(position.materialKey, color, piece);
+}
+
+static int nonPawnMaterial(uint64_t materialKey, int color)
+{
+    int material = 0;
+    for (int piece = Knight; piece <= Queen; piece++) {
+        material += materialCount(materialKey, color, ChessPiece(piece)) * MidgameValue[piece];
+    }
+    return material;
+}
+
+//
+// evaluators, each scoring from strongSide's point of view
+//
+
+// Insufficient material on both sides
+static int evaluateDraw(const Position&, int)
+{
+    return 0;
+}
+
+// Lone king against at least a rook's worth of pieces: drive it to the edge and bring the
+// other king up. Only a stalemate saves the weak side
+static int evaluateKXK(const Position& position, int strongSide)
+{
+    const int weakSide = strongSide ^ 1;
+    if (position.sideToMove == weakSide && !position.inCheck()) {
+        MoveList moves;
+        generateLegalMoves(position, moves);
+        if (moves.count == 0) {
+            return 0;
+        }
+    }
+
+    const int strongKing = position.kingSquare(strongSide);
+    const int weakKing = position.kingSquare(weakSide);
+    int score = pushToEdge(weakKing) + pushClose(strongKing, weakKing);
+    for (int piece = Pawn; piece <= Queen; piece++) {
+        score += count(position, strongSide, ChessPiece(piece)) * EndgameValue[piece];
+    }
+
+    const uint64_t bishops = position.pieces[strongSide][Bishop];
+    if (position.pieces[strongSide][Queen] || position.pieces[strongSide][Rook]
+        || (bishops && position.pieces[strongSide][Knight])
+        || ((bishops & DarkSquares) && (bishops & ~DarkSquares))) {
+        score += KnownWin;
+    }
+    return score;
+}
+
+// Bishop and knight: the lone king can only be mated in a corner the bishop covers
+static int evaluateKBNK(const Position& position, int strongSide)
+{
+    const int strongKing = position.kingSquare(strongSide);
+    const int weakKing = position.kingSquare(strongSide ^ 1);
+    const int row = weakKing / 8;
+    const int col = weakKing % 8;
+    // 7 in the a1 and h8 corners for a dark-squared bishop, a8 and h1 for a light one
+    const bool darkBishop = position.pieces[strongSide][Bishop] & DarkSquares;
+    const int cornerPush = darkBishop ? std::abs(7 - row - col) : std::abs(row - col);
+    return KnownWin + pushClose(strongKing, weakKing) + 40 * cornerPush + pushToEdge(weakKing);
+}
+
+// Rook against pawn: a win unless the pawn is far advanced and its king is closer to it
+// than the strong king
+static int evaluateKRKP(const Position& position, int strongSide)
+{
+    const int weakSide = strongSide ^ 1;
+    const int strongKing = relativeSquare(position.kingSquare(strongSide), strongSide);
+    const int weakKing = relativeSquare(position.kingSquare(weakSide), strongSide);
+    const int rook = relativeSquare(std::countr_zero(position.pieces[strongSide][Rook]), strongSide);
+    const int pawn = relativeSquare(std::countr_zero(position.pieces[weakSide][Pawn]), strongSide);
+    // the pawn runs towards row 0 from here on
+    const int queening = pawn % 8;
+    const int rookValue = EndgameValue[Rook];
+
+    if (strongKing % 8 == pawn % 8 && strongKing < pawn) {
+        // the strong king stands in the pawn's path
+        return rookValue - distance(strongKing, pawn);
+    }
+    if (distance(weakKing, pawn) >= 3 + (position.sideToMove == weakSide) && distance(weakKing, rook) >= 3) {
+        // the weak king is too far away to help its pawn or harass the rook
+        return rookValue - distance(strongKing, pawn);
+    }
+    if (weakKing / 8 <= 2 && distance(weakKing, pawn) == 1 && strongKing / 8 >= 3
+        && distance(strongKing, pawn) > 2 + (position.sideToMove == strongSide)) {
+        // an advanced pawn the strong king cannot reach in time
+        return 80 - 8 * distance(strongKing, pawn);
+    }
+    return 200 - 8 * (distance(strongKing, pawn - 8) - distance(weakKing, pawn - 8) - distance(pawn, queening));
+}
+
+// Rook against bishop is usually a draw, the rook side presses by cornering the king
+static int evaluateKRKB(const Position& position, int strongSide)
+{
+    return pushToEdge(position.kingSquare(strongSide ^ 1)) / 4;
+}
+
+// Rook against knight: drawn unless the king and knight get separated
+static int evaluateKRKN(const Position& position, int strongSide)
+{
+    const int weakKing = position.kingSquare(strongSide ^ 1);
+    const int knight = std::countr_zero(position.pieces[strongSide ^ 1][Knight]);
+    return pushToEdge(weakKing) / 4 + 12 * distance(weakKing, knight);
+}
+
+// Queen against rook wins, though slowly: press the king towards the edge
+static int evaluateKQKR(const Position& position, int strongSide)
+{
+    const int strongKing = position.kingSquare(strongSide);
+    const int weakKing = position.kingSquare(strongSide ^ 1);
+    return EndgameValue[Queen] - EndgameValue[Rook] + pushToEdge(weakKing) + pushClose(strongKing, weakKing);
+}
+
+//
+// scaling functions
+//
+
+// Bishops on opposite colors each guard squares the other cannot contest, so an extra pawn
+// or two rarely wins. Less so with other pieces still on the board
+static int scaleOppositeBishops(const Position& position, int strongSide)
+{
+    const uint64_t ours = position.pieces[strongSide][Bishop];
+    const uint64_t theirs = position.pieces[strongSide ^ 1][Bishop];
+    if (std::popcount(ours) != 1 || std::popcount(theirs) != 1 || !(ours & DarkSquares) == !(theirs & DarkSquares)) {
+        return NoScale;
+    }
+    const uint64_t others = position.occupied() & ~(ours | theirs)
+        & ~(position.pieces[White][Pawn] | position.pieces[Black][Pawn] | position.pieces[White][King] | position.pieces[Black][King]);
+    if (others) {
+        return 48;
+    }
+    const int extraPawns = count(position, strongSide, Pawn) - count(position, strongSide ^ 1, Pawn);
+    return std::min(ScaleNormal, 16 + 6 * std::max(extraPawns, 0));
+}
+
+// Bishop and rook pawns: the wrong bishop cannot drive a king out of the queening corner
+static int scaleBishopPawns(const Position& position, int strongSide)
+{
+    const int weakSide = strongSide ^ 1;
+    const uint64_t pawns = position.pieces[strongSide][Pawn];
+    for (uint64_t file : { FileA, FileH }) {
+        if (pawns & ~file) {
+            continue;
+        }
+        const int queening = relativeSquare(56 + std::countr_zero(file), strongSide);
+        const bool darkQueening = DarkSquares & (1ULL << queening);
+        const bool darkBishop = position.pieces[strongSide][Bishop] & DarkSquares;
+        if (darkQueening != darkBishop && distance(position.kingSquare(weakSide), queening) <= 1) {
+            return 0;
+        }
+    }
+    return scaleOppositeBishops(position, strongSide);
+}
+
+//
+// the table of known endgames
+//
+
+struct KnownEndgame
+{
+    uint64_t            key;
+    EndgameEvaluator    evaluator;
+    uint8_t             strongSide;
+};
+
+static const std::vector<KnownEndgame>& knownEndgames()
+{
+    static const std::vector<KnownEndgame> endgames = [] {
+        std::vector<KnownEndgame> list;
+        auto add = [&list](const char* code, EndgameEvaluator evaluator) {
+            for (int side = White; side <= Black; side++) {
+                list.push_back({ materialKeyOf(code, side), evaluator, uint8_t(side) });
+            }
+        };
+        add("KK", evaluateDraw);
+        add("KNK", evaluateDraw);
+        add("KBK", evaluateDraw);
+        add("KNNK", evaluateDraw);
+        add("KBNK", evaluateKBNK);
+        add("KRKP", evaluateKRKP);
+        add("KRKB", evaluateKRKB);
+        add("KRKN", evaluateKRKN);
+        add("KQKR", evaluateKQKR);
+        return list;
+    }();
+    return endgames;
+}
+
+uint64_t materialKeyOf(const char* code, int strongSide)
+{
+    static const char letters[] = " PNBRQ";
+    uint64_t key = 0;
+    int color = strongSide ^ 1;
+    for (const char* c = code; *c; c++) {
+        if (*c == 'K') {
+            color ^= 1;
+            continue;
+        }
+        for (int piece = Pawn; piece <= Queen; piece++) {
+            if (*c == letters[piece]) {
+                key += materialUnit(color, ChessPiece(piece));
+            }
+        }
+    }
+    return key;
+}
+
+void imbalanceTerms(uint64_t materialKey, int color, int terms[ImbalanceTermCount])
+{
+    const int pawns = materialCount(materialKey, color, Pawn);
+    const int rooks = materialCount(materialKey, color, Rook);
+    terms[ImbalanceKnightPawns] = materialCount(materialKey, color, Knight) * (pawns - 5);
+    terms[ImbalanceRookPawns] = rooks * (pawns - 5);
+    terms[ImbalanceBishopPair] = materialCount(materialKey, color, Bishop) >= 2;
+    terms[ImbalanceRedundantRook] = rooks >= 2;
+    terms[ImbalanceQueenRook] = materialCount(materialKey, color, Queen) && rooks;
+}
+
+// Second-order material terms the piece values miss, from color's side
+static void imbalance(uint64_t materialKey, int color, int& midgame, int& endgame)
+{
+    int terms[ImbalanceTermCount];
+    imbalanceTerms(materialKey, color, terms);
+    for (int stage = 0; stage < 2; stage++) {
+        const int score = terms[ImbalanceKnightPawns] * KnightPawnAdjust[stage] + terms[ImbalanceRookPawns] * RookPawnAdjust[stage]
+                        + terms[ImbalanceBishopPair] * BishopPair[stage] + terms[ImbalanceRedundantRook] * RedundantRook[stage]
+                        + terms[ImbalanceQueenRook] * QueenRook[stage];
+        (stage == 0 ? midgame : endgame) += score;
+    }
+}
+
+void analyseMaterial(const Position& position, MaterialEntry& entry)
+{
+    const uint64_t key = position.materialKey;
+    entry = MaterialEntry();
+    entry.key = key;
+    entry.factor[White] = entry.factor[Black] = ScaleNormal;
+
+    for (const KnownEndgame& endgame : knownEndgames()) {
+        if (endgame.key == key) {
+            entry.evaluator = endgame.evaluator;
+            entry.evaluatorSide = endgame.strongSide;
+            return;
+        }
+    }
+
+    for (int side = White; side <= Black; side++) {
+        const int weakSide = side ^ 1;
+        const bool weakBare = !((key >> materialShift(weakSide, Pawn)) & 0xFFFFF);
+        if (weakBare && nonPawnMaterial(key, side) >= MidgameValue[Rook]) {
+            entry.evaluator = evaluateKXK;
+            entry.evaluatorSide = uint8_t(side);
+            return;
+        }
+    }
+
+    int whiteMidgame = 0, whiteEndgame = 0, blackMidgame = 0, blackEndgame = 0;
+    imbalance(key, White, whiteMidgame, whiteEndgame);
+    imbalance(key, Black, blackMidgame, blackEndgame);
+    entry.midgame = int16_t(whiteMidgame - blackMidgame);
+    entry.endgame = int16_t(whiteEndgame - blackEndgame);
+
+    for (int side = White; side <= Black; side++) {
+        const int weakSide = side ^ 1;
+        const int pawns = materialCount(key, side, Pawn);
+        const int ours = nonPawnMaterial(key, side);
+        const int theirs = nonPawnMaterial(key, weakSide);
+
+        // without pawns, a minor piece ahead is not enough to win
+        if (pawns <= 1 && ours - theirs <= MidgameValue[Bishop]) {
+            if (pawns == 1) {
+                entry.factor[side] = 48;
+            } else {
+                entry.factor[side] = ours < MidgameValue[Rook] ? 0 : theirs <= MidgameValue[Bishop] ? 4 : 14;
+            }
+        }
+
+        const bool bishopAndPawns = pawns && ours == MidgameValue[Bishop] && materialCount(key, side, Bishop) == 1;
+        if (bishopAndPawns) {
+            entry.scaler[side] = scaleBishopPawns;
+        } else if (materialCount(key, side, Bishop) == 1 && materialCount(key, weakSide, Bishop) == 1) {
+            entry.scaler[side] = scaleOppositeBishops;
+        }
+    }
+}
+
+MaterialTable::MaterialTable(int entries)
+{
+    _entries.resize(std::bit_floor(unsigned(std::max(entries, 2))));
+    _shift = 64 - std::countr_zero(_entries.size());
+    // key 0 is two bare kings, which must not hit on an empty slot
+    for (MaterialEntry& entry : _entries) {
+        entry.key = ~0ULL;
+    }
+}
+
+const MaterialEntry& MaterialTable::probe(const Position& position)
+{
+    // the key packs small counts into its low bits, so mix it before taking an index
+    MaterialEntry& entry = _entries[(position.materialKey * 0x9E3779B97F4A7C15ULL) >> _shift];
+    if (entry.key != position.materialKey) {
+        analyseMaterial(position, entry);
+    }
+    return entry;
+}
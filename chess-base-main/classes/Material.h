@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include "Position.h"
+
+//
+// what the pieces left on the board say before any of them is looked at: the imbalance terms,
+// and for the endgames with a known answer, a specialised evaluator that replaces the generic
+// one or a scaling function that shrinks its endgame score when the side ahead cannot win.
+// Entries are keyed by Position::materialKey and, like the pawn table, each search thread
+// keeps its own table
+//
+
+// Score clearly better than any ordinary evaluation, well below the mate scores
+constexpr int KnownWin = 10000;
+// Scaling functions return how much of the endgame score to keep, out of ScaleNormal
+constexpr int ScaleNormal = 64;
+
+// Score of a known endgame from strongSide's point of view
+using EndgameEvaluator = int (*)(const Position& position, int strongSide);
+// Fraction of the endgame score strongSide keeps, out of ScaleNormal, or NoScale if the
+// position is not one it knows about after all
+constexpr int NoScale = -1;
+using EndgameScaler = int (*)(const Position& position, int strongSide);
+
+struct MaterialEntry
+{
+    uint64_t        key;
+    int16_t         midgame;            // imbalance terms, from white's side
+    int16_t         endgame;
+    EndgameEvaluator evaluator;         // replaces the generic evaluation, nullptr if there is none
+    uint8_t         evaluatorSide;      // the strong side the evaluator scores for
+    uint8_t         factor[2];          // scale by side ahead when there is no scaler
+    EndgameScaler   scaler[2];
+
+    // Centipawns from the side to move's point of view, only when evaluator is set
+    int evaluate(const Position& position) const {
+        const int score = evaluator(position, evaluatorSide);
+        return position.sideToMove == evaluatorSide ? score : -score;
+    }
+
+    // Out of ScaleNormal, for an endgame score in strongSide's favour
+    int scale(const Position& position, int strongSide) const {
+        const int scale = scaler[strongSide] ? scaler[strongSide](position, strongSide) : NoScale;
+        return scale != NoScale ? scale : factor[strongSide];
+    }
+};
+
+// The counts the imbalance weights of EvalWeights.h are multiplied by, for the tuner
+enum ImbalanceTerm
+{
+    ImbalanceKnightPawns,       // KnightPawnAdjust
+    ImbalanceRookPawns,         // RookPawnAdjust
+    ImbalanceBishopPair,        // BishopPair
+    ImbalanceRedundantRook,     // RedundantRook
+    ImbalanceQueenRook,         // QueenRook
+    ImbalanceTermCount
+};
+void imbalanceTerms(uint64_t materialKey, int color, int terms[ImbalanceTermCount]);
+
+// Fills entry from scratch
+void analyseMaterial(const Position& position, MaterialEntry& entry);
+
+// Material key of a piece code such as "KBNK": the strong side's king and pieces, then the
+// weak side's
+uint64_t materialKeyOf(const char* code, int strongSide);
+
+class MaterialTable
+{
+public:
+    explicit MaterialTable(int entries = 8192);
+
+    // The entry for position's material, analysed first if it was not in the table
+    const MaterialEntry& probe(const Position& position);
+
+private:
+    std::vector<MaterialEntry>  _entries;
+    int                         _shift;
+};
@@ -0,0 +1,304 @@
+#include "MoveGen.h"
+#include "Attacks.h"
+
+static inline void addMoves(MoveList& moves, int fromSquare, uint64_t targets, ChessPiece piece, uint64_t enemyPieces)
+{
+    BitBoard(targets).forEachBit([&](int toSquare) {
+        int flags = (enemyPieces >> toSquare) & 1 ? MoveCapture : 0;
+        moves.add(BitMove(fromSquare, toSquare, piece, flags));
+    });
+}
+
+// Pawn targets found set-wise, the origin of each is its target minus delta
+static inline void addPawnMoves(MoveList& moves, uint64_t targets, int delta, int flags)
+{
+    BitBoard(targets).forEachBit([&](int toSquare) {
+        moves.add(BitMove(toSquare - delta, toSquare, Pawn, flags));
+    });
+}
+
+// reaching the last rank always promotes, queen first since it is nearly always best
+static inline void addPromotions(MoveList& moves, uint64_t targets, int delta, int flags)
+{
+    BitBoard(targets).forEachBit([&](int toSquare) {
+        int fromSquare = toSquare - delta;
+        moves.add(BitMove(fromSquare, toSquare, Pawn, flags | Queen));
+        moves.add(BitMove(fromSquare, toSquare, Pawn, flags | Rook));
+        moves.add(BitMove(fromSquare, toSquare, Pawn, flags | Bishop));
+        moves.add(BitMove(fromSquare, toSquare, Pawn, flags | Knight));
+    });
+}
+
+// Pushes, double pushes, captures and promotions for a whole set of pawns at once:
+// each kind is one shift of the pawn bitboard masked by files and ranks, then bit-scanned.
+// allowed limits the targets (check evasions, pin lines)
+template <int Us, GenType Type>
+static void generatePawnSet(const Position& position, MoveList& moves, uint64_t pawns, uint64_t allowed)
+{
+    constexpr int up = Us == White ? 8 : -8;
+    constexpr int upLeft = Us == White ? 7 : -9;
+    constexpr int upRight = Us == White ? 9 : -7;
+    constexpr uint64_t doublePushRank = Us == White ? Rank3 : Rank6;   // where a single push from the start lands
+    constexpr uint64_t promotionRank = Us == White ? Rank8 : Rank1;
+
+    const uint64_t empty = ~position.occupied();
+    const uint64_t enemyPieces = position.colorPieces(Us ^ 1);
+
+    uint64_t single = (Us == White ? shiftUp(pawns) : shiftDown(pawns)) & empty;
+    uint64_t doubles = (Us == White ? shiftUp(single & doublePushRank) : shiftDown(single & doublePushRank)) & empty & allowed;
+    single &= allowed;
+    uint64_t left = (Us == White ? shiftUpLeft(pawns) : shiftDownLeft(pawns)) & enemyPieces & allowed;
+    uint64_t right = (Us == White ? shiftUpRight(pawns) : shiftDownRight(pawns)) & enemyPieces & allowed;
+
+    if (Type != GenQuiet) {
+        if ((single | left | right) & promotionRank) {
+            addPromotions(moves, left & promotionRank, upLeft, MoveCapture);
+            addPromotions(moves, right & promotionRank, upRight, MoveCapture);
+            addPromotions(moves, single & promotionRank, up, 0);
+        }
+        addPawnMoves(moves, left & ~promotionRank, upLeft, MoveCapture);
+        addPawnMoves(moves, right & ~promotionRank, upRight, MoveCapture);
+    }
+    if (Type != GenNoisy) {
+        addPawnMoves(moves, single & ~promotionRank, up, 0);
+        addPawnMoves(moves, doubles, 2 * up, MoveDoublePush);
+    }
+}
+
+template <GenType Type>
+static void generatePawnMoves(const Position& position, MoveList& moves, uint64_t checkMask, uint64_t pinned, int kingSquare)
+{
+    const int us = position.sideToMove;
+    const int them = us ^ 1;
+    const uint64_t pawns = position.pieces[us][Pawn];
+    auto generate = us == White ? generatePawnSet<White, Type> : generatePawnSet<Black, Type>;
+
+    generate(position, moves, pawns & ~pinned, checkMask);
+
+    // a pinned pawn may only move along the line joining it to its king
+    BitBoard(pawns & pinned).forEachBit([&](int fromSquare) {
+        generate(position, moves, 1ULL << fromSquare, checkMask & lineThrough(kingSquare, fromSquare));
+    });
+
+    if (Type == GenQuiet || position.epSquare == NoSquare) {
+        return;
+    }
+
+    const int epSquare = position.epSquare;
+    const int capturedSquare = epSquare + (us == White ? -8 : 8);
+    // the capture has to resolve any check, either by taking the checker or blocking
+    if (!(checkMask & ((1ULL << epSquare) | (1ULL << capturedSquare)))) {
+        return;
+    }
+    const uint64_t occupied = position.occupied();
+    const uint64_t rooksQueens = position.pieces[them][Rook] | position.pieces[them][Queen];
+    const uint64_t bishopsQueens = position.pieces[them][Bishop] | position.pieces[them][Queen];
+
+    // at most two pawns can take en passant, so these are handled one at a time
+    BitBoard(pawnAttacks(them, epSquare) & pawns).forEachBit([&](int fromSquare) {
+        // two pawns leave the rank at once, so re-test the king against the enemy sliders;
+        // this also covers a pawn pinned on a diagonal
+        uint64_t after = (occupied ^ (1ULL << fromSquare) ^ (1ULL << capturedSquare)) | (1ULL << epSquare);
+        if ((rookAttacks(kingSquare, after) & rooksQueens) || (bishopAttacks(kingSquare, after) & bishopsQueens)) {
+            return;
+        }
+        moves.add(BitMove(fromSquare, epSquare, Pawn, MoveCapture | MoveEnPassant));
+    });
+}
+
+static void generateCastlingMoves(const Position& position, MoveList& moves)
+{
+    const int us = position.sideToMove;
+    const uint64_t occupied = position.occupied();
+    const uint64_t attacked = position.attackedBy(us ^ 1);
+    const int kingSquare = us == White ? 4 : 60;
+    const uint8_t kingside = us == White ? WhiteKingside : BlackKingside;
+    const uint8_t queenside = us == White ? WhiteQueenside : BlackQueenside;
+
+    if (!(position.pieces[us][King] & (1ULL << kingSquare))) {
+        return;
+    }
+
+    auto isSafe = [&](int square) {
+        return !(attacked & (1ULL << square));
+    };
+
+    // king goes e -> g, rook h -> f; f and g must be empty and not attacked
+    if ((position.castling & kingside) && (position.pieces[us][Rook] & (1ULL << (kingSquare + 3)))) {
+        uint64_t path = (1ULL << (kingSquare + 1)) | (1ULL << (kingSquare + 2));
+        if (!(occupied & path) && isSafe(kingSquare + 1) && isSafe(kingSquare + 2)) {
+            moves.add(BitMove(kingSquare, kingSquare + 2, King, MoveCastle));
+        }
+    }
+    // king goes e -> c, rook a -> d; b, c and d must be empty, only c and d need to be safe
+    if ((position.castling & queenside) && (position.pieces[us][Rook] & (1ULL << (kingSquare - 4)))) {
+        uint64_t path = (1ULL << (kingSquare - 1)) | (1ULL << (kingSquare - 2)) | (1ULL << (kingSquare - 3));
+        if (!(occupied & path) && isSafe(kingSquare - 1) && isSafe(kingSquare - 2)) {
+            moves.add(BitMove(kingSquare, kingSquare - 2, King, MoveCastle));
+        }
+    }
+}
+
+template <GenType Type>
+void generateMoves(const Position& position, MoveList& moves)
+{
+    const int us = position.sideToMove;
+    const int them = us ^ 1;
+    const uint64_t ourPieces = position.colorPieces(us);
+    const uint64_t enemyPieces = position.colorPieces(them);
+    const uint64_t occupied = ourPieces | enemyPieces;
+    const int kingSquare = position.kingSquare(us);
+    // squares pieces other than pawns may move to: captures, empty squares or both
+    const uint64_t typeMask = Type == GenNoisy ? enemyPieces : Type == GenQuiet ? ~occupied : ~0ULL;
+
+    uint64_t checkers = position.checkers();
+
+    // King: any square the enemy does not attack. Their map sees through our king,
+    // so it cannot hide behind itself from a slider it is moving away from
+    addMoves(moves, kingSquare, kingAttacks(kingSquare) & ~ourPieces & typeMask & ~position.attackedBy(them), King, enemyPieces);
+
+    // double check: only the king can move
+    if (std::popcount(checkers) > 1) {
+        return;
+    }
+
+    // in single check every other piece must capture the checker or block the ray
+    uint64_t checkMask = ~0ULL;
+    if (checkers) {
+        checkMask = checkers | betweenSquares(kingSquare, std::countr_zero(checkers));
+    } else if (Type != GenNoisy) {
+        generateCastlingMoves(position, moves);
+    }
+
+    // Pins: enemy sliders that would see our king through exactly one of our pieces
+    uint64_t pinned = 0;
+    uint64_t snipers = (rookAttacks(kingSquare, enemyPieces) & (position.pieces[them][Rook] | position.pieces[them][Queen]))
+                     | (bishopAttacks(kingSquare, enemyPieces) & (position.pieces[them][Bishop] | position.pieces[them][Queen]));
+    BitBoard(snipers).forEachBit([&](int sniperSquare) {
+        uint64_t blockers = betweenSquares(kingSquare, sniperSquare) & occupied;
+        if (std::popcount(blockers) == 1 && (blockers & ourPieces)) {
+            pinned |= blockers;
+        }
+    });
+
+    const uint64_t targets = ~ourPieces & checkMask & typeMask;
+
+    generatePawnMoves<Type>(position, moves, checkMask, pinned, kingSquare);
+
+    // a pinned knight can never stay on its pin line
+    BitBoard(position.pieces[us][Knight] & ~pinned).forEachBit([&](int fromSquare) {
+        addMoves(moves, fromSquare, knightAttacks(fromSquare) & targets, Knight, enemyPieces);
+    });
+
+    auto sliderTargets = [&](int fromSquare, uint64_t attacks) {
+        uint64_t valid = attacks & targets;
+        if (pinned & (1ULL << fromSquare)) {
+            valid &= lineThrough(kingSquare, fromSquare);
+        }
+        return valid;
+    };
+
+    BitBoard(position.pieces[us][Bishop]).forEachBit([&](int fromSquare) {
+        addMoves(moves, fromSquare, sliderTargets(fromSquare, bishopAttacks(fromSquare, occupied)), Bishop, enemyPieces);
+    });
+    BitBoard(position.pieces[us][Rook]).forEachBit([&](int fromSquare) {
+        addMoves(moves, fromSquare, sliderTargets(fromSquare, rookAttacks(fromSquare, occupied)), Rook, enemyPieces);
+    });
+    BitBoard(position.pieces[us][Queen]).forEachBit([&](int fromSquare) {
+        addMoves(moves, fromSquare, sliderTargets(fromSquare, queenAttacks(fromSquare, occupied)), Queen, enemyPieces);
+    });
+}
+
+template void generateMoves<GenAll>(const Position& position, MoveList& moves);
+template void generateMoves<GenNoisy>(const Position& position, MoveList& moves);
+template void generateMoves<GenQuiet>(const Position& position, MoveList& moves);
+
+bool isLegalMove(const Position& position, const BitMove& move)
+{
+    const int us = position.sideToMove;
+    const int them = us ^ 1;
+    if (move.piece < Pawn || move.piece > King || move.from > 63 || move.to > 63
+        || position.pieceOn(move.from) != pieceTag(us, ChessPiece(move.piece))) {
+        return false;
+    }
+    // castling, en passant and promotions are rare enough to check against the generator
+    if (move.flags & (MoveCastle | MoveEnPassant | MovePromotionMask)) {
+        MoveList moves;
+        generateLegalMoves(position, moves);
+        return moves.contains(move);
+    }
+
+    // the capture flag has to agree with what is on the target square
+    const uint8_t target = position.pieceOn(move.to);
+    if (target ? tagColor(target) == us || !move.isCapture() : move.isCapture()) {
+        return false;
+    }
+    if ((move.flags & MoveDoublePush) && move.piece != Pawn) {
+        return false;
+    }
+
+    const uint64_t occupied = position.occupied();
+    const uint64_t fromBit = 1ULL << move.from;
+    const uint64_t toBit = 1ULL << move.to;
+    const int up = us == White ? 8 : -8;
+    uint64_t reach = 0;
+    switch (move.piece) {
+        case Pawn:
+            // a pawn reaching the last rank without promoting is not a move at all
+            if (toBit & (Rank1 | Rank8)) {
+                return false;
+            }
+            if (move.isCapture()) {
+                reach = pawnAttacks(us, move.from);
+            } else if (move.flags & MoveDoublePush) {
+                bool onStart = (us == White ? Rank1 << 8 : Rank8 >> 8) & fromBit;
+                if (onStart && move.to == move.from + 2 * up && !(occupied & (1ULL << (move.from + up)))) {
+                    reach = toBit;
+                }
+            } else if (move.to == move.from + up) {
+                reach = toBit;
+            }
+            break;
+        case Knight: reach = knightAttacks(move.from); break;
+        case Bishop: reach = bishopAttacks(move.from, occupied); break;
+        case Rook:   reach = rookAttacks(move.from, occupied); break;
+        case Queen:  reach = queenAttacks(move.from, occupied); break;
+        case King:   reach = kingAttacks(move.from); break;
+    }
+    if (!(reach & toBit)) {
+        return false;
+    }
+
+    if (move.piece == King) {
+        return !(position.attackedBy(them) & toBit);
+    }
+    const int kingSquare = position.kingSquare(us);
+    const uint64_t checkers = position.checkers();
+    if (checkers) {
+        if (std::popcount(checkers) > 1) {
+            return false;
+        }
+        if (!((checkers | betweenSquares(kingSquare, std::countr_zero(checkers))) & toBit)) {
+            return false;
+        }
+    }
+    // not pinned: no enemy slider sees the king once the piece has moved (a captured one cannot)
+    const uint64_t after = (occupied ^ fromBit) | toBit;
+    const uint64_t rooksQueens = (position.pieces[them][Rook] | position.pieces[them][Queen]) & ~toBit;
+    const uint64_t bishopsQueens = (position.pieces[them][Bishop] | position.pieces[them][Queen]) & ~toBit;
+    return !(rookAttacks(kingSquare, after) & rooksQueens) && !(bishopAttacks(kingSquare, after) & bishopsQueens);
+}
+
+std::string moveToString(const BitMove& move)
+{
+    const char promotions[] = { 0, 0, 'n', 'b', 'r', 'q', 0 };
+    std::string text;
+    text += char('a' + move.from % 8);
+    text += char('1' + move.from / 8);
+    text += char('a' + move.to % 8);
+    text += char('1' + move.to / 8);
+    if (move.promotion()) {
+        text += promotions[move.promotion()];
+    }
+    return text;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Position.h"
+
+constexpr int MaxMoves = 256;   // no legal chess position has more than 218 moves
+
+// Fixed-capacity move list meant to live on the stack, one per search node.
+struct MoveList
+{
+    BitMove     moves[MaxMoves];
+    int         count = 0;
+
+    void add(const BitMove& move) { moves[count++] = move; }
+    void clear() { count = 0; }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    BitMove& operator[](int index) { return moves[index]; }
+    const BitMove& operator[](int index) const { return moves[index]; }
+
+    BitMove* begin() { return moves; }
+    BitMove* end() { return moves + count; }
+    const BitMove* begin() const { return moves; }
+    const BitMove* end() const { return moves + count; }
+
+    bool contains(const BitMove& move) const {
+        for (const BitMove& m : *this) {
+            if (m == move) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Which legal moves to generate: noisy moves are captures (en passant included) and
+// promotions, quiet moves are everything else. Noisy plus quiet is exactly all
+enum GenType
+{
+    GenAll,
+    GenNoisy,
+    GenQuiet
+};
+
+// Appends the legal moves of the given type for the side to move.
+// Legality comes from check and pin masks and the enemy attack map, no move is ever made and
+// taken back. Only the position's own attack cache is written, so threads can generate moves
+// at once as long as each works on its own Position.
+// The position must have exactly one king per side.
+template <GenType Type>
+void generateMoves(const Position& position, MoveList& moves);
+
+inline void generateLegalMoves(const Position& position, MoveList& moves) { generateMoves<GenAll>(position, moves); }
+
+// True if move, typically from the hash table or a killer slot, is legal in position;
+// checked directly so the search can try it before generating anything
+bool isLegalMove(const Position& position, const BitMove& move);
+
+// Long algebraic notation as used by UCI, e.g. "e2e4" or "e7e8q"
+std::string moveToString(const BitMove& move);
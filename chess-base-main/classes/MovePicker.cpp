@@ -0,0 +1,200 @@
+#include "MovePicker.h"
+#include "Evaluate.h"
+
+bool seeAtLeast(const Position& position, const BitMove& move, int threshold)
+{
+    if (move.flags & (MoveCastle | MoveEnPassant | MovePromotionMask)) {
+        return 0 >= threshold;
+    }
+
+    // swap is what the side to move stands to gain if the exchange stopped here; after our
+    // capture it must beat the threshold even if we lose the capturing piece in return
+    const int to = move.to;
+    int swap = PieceValue[tagPiece(position.pieceOn(to))] - threshold;
+    if (swap < 0) {
+        return false;
+    }
+    swap = PieceValue[move.piece] - swap;
+    if (swap <= 0) {
+        return true;
+    }
+
+    const uint64_t (&p)[2][7] = position.pieces;
+    const uint64_t bishopsQueens = p[White][Bishop] | p[White][Queen] | p[Black][Bishop] | p[Black][Queen];
+    const uint64_t rooksQueens = p[White][Rook] | p[White][Queen] | p[Black][Rook] | p[Black][Queen];
+    uint64_t occupied = position.occupied() ^ (1ULL << move.from) ^ (1ULL << to);
+    uint64_t attackers = position.attackersTo(to, occupied);
+    int side = position.sideToMove;
+    int result = 1;
+
+    while (true) {
+        side ^= 1;
+        attackers &= occupied;
+        uint64_t sideAttackers = attackers & position.colorPieces(side);
+        if (!sideAttackers) {
+            break;
+        }
+        result ^= 1;
+
+        // recapture with the least valuable piece; removing it may uncover a slider behind
+        int piece = Pawn;
+        while (piece < King && !(sideAttackers & p[side][piece])) {
+            piece++;
+        }
+        if (piece == King) {
+            // the king may only take last, when nothing else can take back
+            return (attackers & position.colorPieces(side ^ 1)) ? result ^ 1 : result;
+        }
+        swap = PieceValue[piece] - swap;
+        if (swap < result) {
+            break;
+        }
+        uint64_t attacker = sideAttackers & p[side][piece];
+        occupied ^= attacker & (~attacker + 1);
+        if (piece == Pawn || piece == Bishop || piece == Queen) {
+            attackers |= bishopAttacks(to, occupied) & bishopsQueens;
+        }
+        if (piece == Rook || piece == Queen) {
+            attackers |= rookAttacks(to, occupied) & rooksQueens;
+        }
+    }
+    return result;
+}
+
+MovePicker::MovePicker(const Position& position, const BitMove& hashMove, const BitMove* killers,
+                       const BitMove& counterMove, const HistoryTable& history)
+    : _position(position), _history(history), _hashMove(hashMove), _counterMove(counterMove), _noisyOnly(false)
+{
+    _killers[0] = killers[0];
+    _killers[1] = killers[1];
+}
+
+MovePicker::MovePicker(const Position& position, const BitMove& hashMove, const HistoryTable& history)
+    : _position(position), _history(history), _hashMove(hashMove), _killers{}, _counterMove{},
+      _noisyOnly(!position.inCheck())
+{
+    // a quiet hash move has no place in a noisy-only search
+    if (_noisyOnly && !hashMove.isCapture() && !hashMove.promotion()) {
+        _hashMove = BitMove{};
+    }
+}
+
+BitMove MovePicker::next()
+{
+    while (true) {
+        switch (_stage) {
+            case StageHashMove:
+                _stage = StageGenerateNoisy;
+                if (!(_hashMove == BitMove{}) && isLegalMove(_position, _hashMove)) {
+                    return _hashMove;
+                }
+                break;
+
+            case StageGenerateNoisy:
+                generateMoves<GenNoisy>(_position, _moves);
+                for (int i = 0; i < _moves.size(); i++) {
+                    const BitMove& move = _moves[i];
+                    ChessPiece victim = move.isEnPassant() ? Pawn : tagPiece(_position.pieceOn(move.to));
+                    _scores[i] = PieceValue[victim] * 8 - move.piece + PieceValue[move.promotion()];
+                }
+                _current = 0;
+                _stage = StageNoisy;
+                break;
+
+            case StageNoisy:
+                while (_current < _moves.size()) {
+                    BitMove move = pickBest();
+                    if (move == _hashMove) {
+                        continue;
+                    }
+                    if (!seeAtLeast(_position, move, 0)) {
+                        _badNoisy.add(move);
+                        continue;
+                    }
+                    return move;
+                }
+                _stage = _noisyOnly ? StageDone : StageKiller1;
+                break;
+
+            case StageKiller1:
+                _stage = StageKiller2;
+                if (isUsableQuiet(_killers[0])) {
+                    return _killers[0];
+                }
+                break;
+
+            case StageKiller2:
+                _stage = StageCounterMove;
+                if (!(_killers[1] == _killers[0]) && isUsableQuiet(_killers[1])) {
+                    return _killers[1];
+                }
+                break;
+
+            case StageCounterMove:
+                _stage = StageGenerateQuiets;
+                if (!(_counterMove == _killers[0]) && !(_counterMove == _killers[1]) && isUsableQuiet(_counterMove)) {
+                    return _counterMove;
+                }
+                break;
+
+            case StageGenerateQuiets:
+                _moves.clear();
+                generateMoves<GenQuiet>(_position, _moves);
+                for (int i = 0; i < _moves.size(); i++) {
+                    _scores[i] = _history[_position.sideToMove][_moves[i].from][_moves[i].to];
+                }
+                _current = 0;
+                _stage = StageQuiets;
+                break;
+
+            case StageQuiets:
+                while (_current < _moves.size()) {
+                    BitMove move = pickBest();
+                    if (!isRefutation(move)) {
+                        return move;
+                    }
+                }
+                _stage = StageBadNoisy;
+                break;
+
+            case StageBadNoisy:
+                if (_badCurrent < _badNoisy.size()) {
+                    return _badNoisy[_badCurrent++];
+                }
+                _stage = StageDone;
+                break;
+
+            case StageDone:
+                return BitMove{};
+        }
+    }
+}
+
+// Selection sort one step at a time: most nodes cut off after a move or two,
+// so sorting the whole list up front would mostly be wasted
+BitMove MovePicker::pickBest()
+{
+    int best = _current;
+    for (int i = _current + 1; i < _moves.size(); i++) {
+        if (_scores[i] > _scores[best]) {
+            best = i;
+        }
+    }
+    std::swap(_moves[best], _moves[_current]);
+    std::swap(_scores[best], _scores[_current]);
+    return _moves[_current++];
+}
+
+// Moves an earlier stage has already handed out, if they were legal
+bool MovePicker::isRefutation(const BitMove& move) const
+{
+    return move == _hashMove || move == _killers[0] || move == _killers[1] || move == _counterMove;
+}
+
+// Killers and counter moves come from other positions, so they only count here if they
+// are still quiet, legal and not the hash move
+bool MovePicker::isUsableQuiet(const BitMove& move) const
+{
+    return !(move == BitMove{}) && !(move == _hashMove) && !move.isCapture() && !move.promotion()
+        && isLegalMove(_position, move);
+}
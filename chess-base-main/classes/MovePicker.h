@@ -0,0 +1,71 @@
+#pragma once
+
+#include "MoveGen.h"
+
+//
+// hands the search its moves one at a time, best guesses first, generating each batch only
+// when the moves before it failed to cut off:
+//   1. the hash move, checked for legality and tried before anything is generated
+//   2. noisy moves (captures and promotions), most valuable victim / least valuable attacker first
+//   3. the two killer moves of this ply, then the counter move to the opponent's last move
+//   4. the remaining quiet moves, by history score
+//   5. noisy moves that lose material by static exchange
+// every move returned is legal and none is returned twice
+//
+// the quiescence search uses it too, for noisy moves only (losing captures dropped),
+// or every evasion when in check
+//
+
+// [color][from][to] score of quiet moves that caused cutoffs
+using HistoryTable = int[2][64][64];
+
+// Static exchange evaluation: true if move wins at least threshold centipawns once every
+// capture and recapture on its target square has been played, cheapest attacker first.
+// Pins are ignored; castling, en passant and promotions are taken as even trades
+bool seeAtLeast(const Position& position, const BitMove& move, int threshold);
+
+class MovePicker
+{
+public:
+    // Main search: every legal move
+    MovePicker(const Position& position, const BitMove& hashMove, const BitMove* killers,
+               const BitMove& counterMove, const HistoryTable& history);
+    // Quiescence search: noisy moves that do not lose material, or every evasion when in check
+    MovePicker(const Position& position, const BitMove& hashMove, const HistoryTable& history);
+
+    // The next move to search, BitMove{} once there are none left
+    BitMove next();
+
+private:
+    enum Stage : uint8_t
+    {
+        StageHashMove,
+        StageGenerateNoisy,
+        StageNoisy,
+        StageKiller1,
+        StageKiller2,
+        StageCounterMove,
+        StageGenerateQuiets,
+        StageQuiets,
+        StageBadNoisy,
+        StageDone
+    };
+
+    BitMove pickBest();
+    bool isRefutation(const BitMove& move) const;
+    bool isUsableQuiet(const BitMove& move) const;
+
+    const Position&     _position;
+    const HistoryTable& _history;
+    BitMove             _hashMove;
+    BitMove             _killers[2];
+    BitMove             _counterMove;
+    Stage               _stage = StageHashMove;
+    bool                _noisyOnly;
+
+    MoveList            _moves;
+    int                 _scores[MaxMoves];
+    int                 _current = 0;
+    MoveList            _badNoisy;          // losing captures, put off until everything else
+    int                 _badCurrent = 0;
+};
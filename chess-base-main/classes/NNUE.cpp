@@ -0,0 +1,362 @@
+#include "NNUE.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define NNUE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// GCC and Clang build the SIMD kernels for their instruction set without the whole program
+// needing it, MSVC accepts the intrinsics anywhere
+#if defined(NNUE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#else
+#define TARGET_AVX2
+#define TARGET_SSE41
+#endif
+
+//
+// kernels: every layer loop in one flavour per instruction set
+//
+
+// out = in + the added columns - the removed columns
+using UpdateKernel = void (*)(const int16_t* in, int16_t* out, const int16_t* const* added, int addedCount,
+                              const int16_t* const* removed, int removedCount, int size);
+// Both halves clipped to [0, ActivationMax] and dotted with their output weights
+using OutputKernel = int32_t (*)(const int16_t* us, const int16_t* them, const int8_t* weights, int size);
+
+static void updateScalar(const int16_t* in, int16_t* out, const int16_t* const* added, int addedCount,
+                         const int16_t* const* removed, int removedCount, int size)
+{
+    for (int i = 0; i < size; i++) {
+        int16_t value = in[i];
+        for (int a = 0; a < addedCount; a++) {
+            value += added[a][i];
+        }
+        for (int r = 0; r < removedCount; r++) {
+            value -= removed[r][i];
+        }
+        out[i] = value;
+    }
+}
+
+static int32_t outputScalar(const int16_t* us, const int16_t* them, const int8_t* weights, int size)
+{
+    int32_t sum = 0;
+    for (int i = 0; i < size; i++) {
+        sum += std::clamp<int>(us[i], 0, ActivationMax) * weights[i];
+        sum += std::clamp<int>(them[i], 0, ActivationMax) * weights[size + i];
+    }
+    return sum;
+}
+
+#if defined(NNUE_X86)
+TARGET_SSE41 static void updateSse41(const int16_t* in, int16_t* out, const int16_t* const* added, int addedCount,
+                                     const int16_t* const* removed, int removedCount, int size)
+{
+    for (int i = 0; i < size; i += 8) {
+        __m128i value = _mm_load_si128((const __m128i*)(in + i));
+        for (int a = 0; a < addedCount; a++) {
+            value = _mm_add_epi16(value, _mm_loadu_si128((const __m128i*)(added[a] + i)));
+        }
+        for (int r = 0; r < removedCount; r++) {
+            value = _mm_sub_epi16(value, _mm_loadu_si128((const __m128i*)(removed[r] + i)));
+        }
+        _mm_store_si128((__m128i*)(out + i), value);
+    }
+}
+
+// 16 activations packed to unsigned bytes against 16 signed weights, summed into four int32s.
+// maddubs cannot saturate: two products of at most 127 * 127
+TARGET_SSE41 static __m128i dotSse41(const int16_t* values, const int8_t* weights, __m128i sum)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i max = _mm_set1_epi16(ActivationMax);
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i low = _mm_min_epi16(_mm_max_epi16(_mm_load_si128((const __m128i*)values), zero), max);
+    __m128i high = _mm_min_epi16(_mm_max_epi16(_mm_load_si128((const __m128i*)(values + 8)), zero), max);
+    __m128i activations = _mm_packus_epi16(low, high);
+    __m128i products = _mm_maddubs_epi16(activations, _mm_loadu_si128((const __m128i*)weights));
+    return _mm_add_epi32(sum, _mm_madd_epi16(products, ones));
+}
+
+TARGET_SSE41 static int32_t outputSse41(const int16_t* us, const int16_t* them, const int8_t* weights, int size)
+{
+    __m128i sum = _mm_setzero_si128();
+    for (int i = 0; i < size; i += 16) {
+        sum = dotSse41(us + i, weights + i, sum);
+        sum = dotSse41(them + i, weights + size + i, sum);
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+
+TARGET_AVX2 static void updateAvx2(const int16_t* in, int16_t* out, const int16_t* const* added, int addedCount,
+                                   const int16_t* const* removed, int removedCount, int size)
+{
+    for (int i = 0; i < size; i += 16) {
+        __m256i value = _mm256_load_si256((const __m256i*)(in + i));
+        for (int a = 0; a < addedCount; a++) {
+            value = _mm256_add_epi16(value, _mm256_loadu_si256((const __m256i*)(added[a] + i)));
+        }
+        for (int r = 0; r < removedCount; r++) {
+            value = _mm256_sub_epi16(value, _mm256_loadu_si256((const __m256i*)(removed[r] + i)));
+        }
+        _mm256_store_si256((__m256i*)(out + i), value);
+    }
+}
+
+// As dotSse41 for 32 activations. packus works within each 128-bit lane, the permute puts
+// the bytes back in order to line up with the weights
+TARGET_AVX2 static __m256i dotAvx2(const int16_t* values, const int8_t* weights, __m256i sum)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i max = _mm256_set1_epi16(ActivationMax);
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i low = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((const __m256i*)values), zero), max);
+    __m256i high = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((const __m256i*)(values + 16)), zero), max);
+    __m256i activations = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), _MM_SHUFFLE(3, 1, 2, 0));
+    __m256i products = _mm256_maddubs_epi16(activations, _mm256_loadu_si256((const __m256i*)weights));
+    return _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+}
+
+TARGET_AVX2 static int32_t outputAvx2(const int16_t* us, const int16_t* them, const int8_t* weights, int size)
+{
+    __m256i sum = _mm256_setzero_si256();
+    for (int i = 0; i < size; i += 32) {
+        sum = dotAvx2(us + i, weights + i, sum);
+        sum = dotAvx2(them + i, weights + size + i, sum);
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(half);
+}
+
+static void cpuid(unsigned leaf, unsigned regs[4])
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, int(leaf), 0);
+    for (int i = 0; i < 4; i++) {
+        regs[i] = unsigned(info[i]);
+    }
+#else
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static bool cpuHasSse41()
+{
+    unsigned regs[4];
+    cpuid(1, regs);
+    return (regs[2] >> 19) & 1;     // ECX bit 19
+}
+
+// The CPU must have AVX2 and the OS must save the YMM registers across context switches
+static bool cpuHasAvx2()
+{
+    unsigned regs[4];
+    cpuid(0, regs);
+    if (regs[0] < 7) {
+        return false;
+    }
+    cpuid(1, regs);
+    const bool osSavesYmm = (regs[2] >> 27) & 1;   // OSXSAVE
+    if (!osSavesYmm) {
+        return false;
+    }
+#if defined(_MSC_VER)
+    const uint64_t enabled = _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    const uint64_t enabled = (uint64_t(edx) << 32) | eax;
+#endif
+    if ((enabled & 6) != 6) {
+        return false;
+    }
+    cpuid(7, regs);
+    return (regs[1] >> 5) & 1;      // EBX bit 5
+}
+#endif
+
+struct NetworkKernels {
+    const char*     name;
+    UpdateKernel    update;
+    OutputKernel    output;
+};
+
+static const NetworkKernels scalarKernels = { "scalar", updateScalar, outputScalar };
+#if defined(NNUE_X86)
+static const NetworkKernels sse41Kernels = { "sse4.1", updateSse41, outputSse41 };
+static const NetworkKernels avx2Kernels = { "avx2", updateAvx2, outputAvx2 };
+#endif
+
+static const NetworkKernels* bestKernels()
+{
+#if defined(NNUE_X86)
+    if (cpuHasAvx2()) {
+        return &avx2Kernels;
+    }
+    if (cpuHasSse41()) {
+        return &sse41Kernels;
+    }
+#endif
+    return &scalarKernels;
+}
+
+static const NetworkKernels* kernels = bestKernels();
+
+const char* networkKernelName()
+{
+    return kernels->name;
+}
+
+bool selectNetworkKernels(const char* name)
+{
+    if (!strcmp(name, "scalar")) {
+        kernels = &scalarKernels;
+        return true;
+    }
+#if defined(NNUE_X86)
+    if (!strcmp(name, "sse4.1") && cpuHasSse41()) {
+        kernels = &sse41Kernels;
+        return true;
+    }
+    if (!strcmp(name, "avx2") && cpuHasAvx2()) {
+        kernels = &avx2Kernels;
+        return true;
+    }
+#endif
+    return false;
+}
+
+//
+// network
+//
+
+FeatureDelta featureDelta(const Position& position, const BitMove& move)
+{
+    FeatureDelta delta;
+    const uint8_t us = position.sideToMove;
+    const uint8_t them = us ^ 1;
+    auto remove = [&](uint8_t color, int piece, int square) {
+        delta.removed[delta.removedCount++] = { color, uint8_t(piece), uint8_t(square) };
+    };
+    auto add = [&](uint8_t color, int piece, int square) {
+        delta.added[delta.addedCount++] = { color, uint8_t(piece), uint8_t(square) };
+    };
+
+    remove(us, move.piece, move.from);
+    add(us, move.promotion() ? int(move.promotion()) : int(move.piece), move.to);
+    if (move.isEnPassant()) {
+        remove(them, Pawn, move.to + (us == White ? -8 : 8));
+    } else if (position.pieceOn(move.to)) {
+        remove(them, tagPiece(position.pieceOn(move.to)), move.to);
+    } else if (move.isCastle()) {
+        bool kingside = move.to > move.from;
+        remove(us, Rook, kingside ? move.from + 3 : move.from - 4);
+        add(us, Rook, kingside ? move.from + 1 : move.from - 1);
+    }
+    return delta;
+}
+
+// Inputs are numbered from the perspective side's point of view: its own pieces first, and
+// the board flipped for black so both halves share one set of weights
+const int16_t* Network::column(int perspective, int color, int piece, int square) const
+{
+    int feature = (color == perspective ? 0 : 384) + (piece - 1) * 64 + (perspective == White ? square : square ^ 56);
+    return &_featureWeights[size_t(feature) * _hidden];
+}
+
+bool Network::load(const char* path)
+{
+    _hidden = 0;
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version = 0;
+    uint32_t hidden = 0;
+    bool ok = fread(magic, 1, 4, file) == 4 && !memcmp(magic, "CNUE", 4)
+           && fread(&version, sizeof(version), 1, file) == 1 && version == NetworkVersion
+           && fread(&hidden, sizeof(hidden), 1, file) == 1 && hidden > 0 && hidden <= MaxHidden && hidden % 32 == 0;
+    if (ok) {
+        _featureWeights.resize(size_t(NetworkInputs) * hidden);
+        _featureBias.resize(hidden);
+        _outputWeights.resize(2 * size_t(hidden));
+        ok = fread(_featureWeights.data(), sizeof(int16_t), _featureWeights.size(), file) == _featureWeights.size()
+          && fread(_featureBias.data(), sizeof(int16_t), _featureBias.size(), file) == _featureBias.size()
+          && fread(_outputWeights.data(), sizeof(int8_t), _outputWeights.size(), file) == _outputWeights.size()
+          && fread(&_outputBias, sizeof(_outputBias), 1, file) == 1
+          && fgetc(file) == EOF;
+    }
+    fclose(file);
+
+    if (!ok) {
+        _featureWeights.clear();
+        _featureBias.clear();
+        _outputWeights.clear();
+        return false;
+    }
+    _hidden = int(hidden);
+    return true;
+}
+
+void Network::refresh(const Position& position, Accumulator& accumulator) const
+{
+    for (int perspective = White; perspective <= Black; perspective++) {
+        int16_t* values = accumulator.values[perspective];
+        std::copy(_featureBias.begin(), _featureBias.end(), values);
+        for (int color = White; color <= Black; color++) {
+            for (int piece = Pawn; piece <= King; piece++) {
+                for (uint64_t bits = position.pieces[color][piece]; bits; bits &= bits - 1) {
+                    const int16_t* added = column(perspective, color, piece, std::countr_zero(bits));
+                    kernels->update(values, values, &added, 1, nullptr, 0, _hidden);
+                }
+            }
+        }
+    }
+}
+
+void Network::update(const Accumulator& from, Accumulator& to, const FeatureDelta& delta) const
+{
+    for (int perspective = White; perspective <= Black; perspective++) {
+        const int16_t* added[2];
+        const int16_t* removed[2];
+        for (int i = 0; i < delta.addedCount; i++) {
+            added[i] = column(perspective, delta.added[i].color, delta.added[i].piece, delta.added[i].square);
+        }
+        for (int i = 0; i < delta.removedCount; i++) {
+            removed[i] = column(perspective, delta.removed[i].color, delta.removed[i].piece, delta.removed[i].square);
+        }
+        kernels->update(from.values[perspective], to.values[perspective], added, delta.addedCount,
+                        removed, delta.removedCount, _hidden);
+    }
+}
+
+int Network::evaluate(const Accumulator& accumulator, int sideToMove) const
+{
+    int32_t sum = kernels->output(accumulator.values[sideToMove], accumulator.values[sideToMove ^ 1],
+                                  _outputWeights.data(), _hidden);
+    return int((int64_t(sum) + _outputBias) * NetworkScale / (ActivationMax * OutputWeightScale));
+}
+
+int evaluate(const Position& position, const Network& network)
+{
+    static thread_local Accumulator accumulator;
+    network.refresh(position, accumulator);
+    return network.evaluate(accumulator, position.sideToMove);
+}
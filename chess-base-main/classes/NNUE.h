@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Position.h"
+
+//
+// efficiently updatable neural network evaluation
+// 768 inputs, one per (color, piece, square), feed a hidden layer that is kept twice, once from
+// each side's point of view with the board flipped for black. Those two halves are the
+// accumulators: a move only switches a few inputs on or off, so the search updates them by
+// adding and subtracting weight columns instead of recomputing them. The output layer takes
+// the side to move's half then the other side's, clipped to [0, ActivationMax], as 8-bit
+// activations against 8-bit weights
+//
+// kernels for AVX2, SSE4.1 and plain C++ are all built in, the fastest the CPU supports is
+// picked when the program starts
+//
+// weight file, little-endian:
+//   char     magic[4]          "CNUE"
+//   uint32   version           NetworkVersion
+//   uint32   hidden            hidden layer size per side, a multiple of 32 up to MaxHidden
+//   int16    featureWeights[768][hidden]
+//   int16    featureBias[hidden]
+//   int8     outputWeights[2][hidden]   side to move's half first
+//   int32    outputBias
+// the output in centipawns is (output layer sum + outputBias) * NetworkScale / (ActivationMax * OutputWeightScale)
+//
+
+constexpr uint32_t NetworkVersion = 1;
+constexpr int NetworkInputs = 768;
+constexpr int MaxHidden = 1024;
+constexpr int ActivationMax = 127;
+constexpr int OutputWeightScale = 64;
+constexpr int NetworkScale = 400;
+
+// The hidden layer from both sides' points of view, indexed by PieceColor
+struct alignas(64) Accumulator
+{
+    int16_t     values[2][MaxHidden];
+};
+
+// The inputs a move switches off and on: the moving piece, a capture, a promotion, a castling rook
+struct FeatureDelta
+{
+    struct Feature {
+        uint8_t     color;
+        uint8_t     piece;
+        uint8_t     square;
+    };
+    Feature     removed[2];
+    Feature     added[2];
+    uint8_t     removedCount = 0;
+    uint8_t     addedCount = 0;
+};
+
+// Built for a move on the position before it is made; a null move changes nothing
+FeatureDelta featureDelta(const Position& position, const BitMove& move);
+
+class Network
+{
+public:
+    // Reads a weight file, returns false and keeps no weights if it is missing or malformed
+    bool load(const char* path);
+    bool loaded() const { return _hidden > 0; }
+    int hiddenSize() const { return _hidden; }
+
+    // Accumulator from scratch
+    void refresh(const Position& position, Accumulator& accumulator) const;
+    // to = from with delta applied
+    void update(const Accumulator& from, Accumulator& to, const FeatureDelta& delta) const;
+    // Centipawns from sideToMove's point of view
+    int evaluate(const Accumulator& accumulator, int sideToMove) const;
+
+private:
+    const int16_t* column(int perspective, int color, int piece, int square) const;
+
+    int                     _hidden = 0;
+    std::vector<int16_t>    _featureWeights;    // [768][hidden]
+    std::vector<int16_t>    _featureBias;
+    std::vector<int8_t>     _outputWeights;     // [2][hidden]
+    int32_t                 _outputBias = 0;
+};
+
+// The same interface as the hand-written evaluate(), refreshing an accumulator every call;
+// the search keeps its accumulators up to date instead
+int evaluate(const Position& position, const Network& network);
+
+// Name of the active kernel set, "avx2", "sse4.1" or "scalar"
+const char* networkKernelName();
+// Switches kernel set by name; returns false if this build or CPU cannot run it
+bool selectNetworkKernels(const char* name);
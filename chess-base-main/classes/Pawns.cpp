@@ -0,0 +1,125 @@
+#include "Pawns.h"
+#include "EvalWeights.h"
+#include <bit>
+
+// The neighbouring files of every bit
+static uint64_t adjacentFiles(uint64_t bits) { return ((bits & ~FileH) << 1) | ((bits & ~FileA) >> 1); }
+
+static uint64_t northFill(uint64_t bits)
+{
+    bits |= bits << 8;
+    bits |= bits << 16;
+    return bits | (bits << 32);
+}
+
+static uint64_t southFill(uint64_t bits)
+{
+    bits |= bits >> 8;
+    bits |= bits >> 16;
+    return bits | (bits >> 32);
+}
+
+// Mirrors the board top to bottom, so black's pawns can be scored as if they were white's
+static uint64_t flip(uint64_t bits)
+{
+    uint64_t flipped = 0;
+    for (int row = 0; row < 8; row++) {
+        flipped |= ((bits >> (row * 8)) & 0xFF) << ((7 - row) * 8);
+    }
+    return flipped;
+}
+
+// Counts the terms for ours moving up the board against theirs into color's slots of terms;
+// passed comes back as well
+static void countPawns(uint64_t ours, uint64_t theirs, int color, PawnTerms& terms, uint64_t& passed)
+{
+    const uint64_t files = northFill(southFill(ours));
+    const uint64_t theirAttacks = shiftDownLeft(theirs) | shiftDownRight(theirs);
+    // every square one of our pawns could ever defend by advancing
+    const uint64_t supportSpan = northFill(shiftUpLeft(ours) | shiftUpRight(ours));
+    const uint64_t theirFronts = southFill(shiftDown(theirs));
+
+    const uint64_t doubled = ours & southFill(shiftDown(ours));
+    const uint64_t isolated = ours & ~adjacentFiles(files);
+    // the square in front is covered by an enemy pawn and no neighbour can ever come up to defend it
+    const uint64_t backward = ours & shiftDown(shiftUp(ours) & theirAttacks & ~supportSpan) & ~isolated;
+    passed = ours & ~(theirFronts | adjacentFiles(theirFronts));
+
+    terms.doubled[color] = std::popcount(doubled);
+    terms.isolated[color] = std::popcount(isolated);
+    terms.backward[color] = std::popcount(backward);
+    for (int rank = 0; rank < 8; rank++) {
+        terms.passed[color][rank] = std::popcount(passed & (Rank1 << (rank * 8)));
+    }
+}
+
+// color's share of the pawn structure score, stage 0 for the midgame and 1 for the endgame
+static int scorePawns(const PawnTerms& terms, int color, int stage)
+{
+    int score = terms.doubled[color] * DoubledPawn[stage] + terms.isolated[color] * IsolatedPawn[stage]
+              + terms.backward[color] * BackwardPawn[stage];
+    const int16_t* passedBonus = stage == 0 ? PassedPawnMidgame : PassedPawnEndgame;
+    for (int rank = 0; rank < 8; rank++) {
+        score += terms.passed[color][rank] * passedBonus[rank];
+    }
+    return score;
+}
+
+void analysePawns(const Position& position, PawnEntry& entry, PawnTerms* terms)
+{
+    const uint64_t white = position.pieces[White][Pawn];
+    const uint64_t black = position.pieces[Black][Pawn];
+    PawnTerms counted;
+    uint64_t blackPassed;
+    countPawns(white, black, White, counted, entry.passed[White]);
+    countPawns(flip(black), flip(white), Black, counted, blackPassed);
+
+    entry.key = position.pawnKey;
+    entry.midgame = int16_t(scorePawns(counted, White, 0) - scorePawns(counted, Black, 0));
+    entry.endgame = int16_t(scorePawns(counted, White, 1) - scorePawns(counted, Black, 1));
+    entry.passed[Black] = flip(blackPassed);
+    entry.shield[White] = white & ((Rank1 << 8) | Rank3);
+    entry.shield[Black] = black & (Rank6 | (Rank8 >> 8));
+    if (terms) {
+        *terms = counted;
+    }
+}
+
+int kingShieldPawns(const Position& position, const PawnEntry& entry)
+{
+    int pawns = 0;
+    for (int color = White; color <= Black; color++) {
+        const int king = position.kingSquare(color);
+        const int rank = color == White ? king / 8 : 7 - king / 8;
+        if (rank > 1) {
+            continue;
+        }
+        const uint64_t kingFile = FileA << (king % 8);
+        const uint64_t files = kingFile | adjacentFiles(kingFile);
+        const int shield = std::popcount(entry.shield[color] & files);
+        pawns += color == White ? shield : -shield;
+    }
+    return pawns;
+}
+
+PawnTable::PawnTable(int entries)
+{
+    _entries.resize(std::bit_floor(unsigned(std::max(entries, 1))));
+    _mask = _entries.size() - 1;
+    // key 0 is a pawnless position, which must not hit on an empty slot
+    for (PawnEntry& entry : _entries) {
+        entry.key = ~0ULL;
+    }
+}
+
+const PawnEntry& PawnTable::probe(const Position& position)
+{
+    PawnEntry& entry = _entries[position.pawnKey & _mask];
+    _probes++;
+    if (entry.key == position.pawnKey) {
+        _hits++;
+    } else {
+        analysePawns(position, entry);
+    }
+    return entry;
+}
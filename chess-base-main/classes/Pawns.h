@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include "Position.h"
+
+//
+// pawn structure evaluation and the table that caches it
+// the structure only changes on pawn moves and captures of pawns, so nearly every node finds
+// its analysis already done: entries are keyed by Position::pawnKey and each search thread
+// has a table of its own, so probes need no locking
+//
+
+struct PawnEntry
+{
+    uint64_t    key;
+    int16_t     midgame;        // doubled, isolated, backward and passed pawn terms, from white's side
+    int16_t     endgame;
+    uint64_t    passed[2];      // passed pawns of each color
+    uint64_t    shield[2];      // pawns on each color's second and third ranks, which can cover a castled king
+};
+
+// How many pawns of each color every structure term applies to, for the tuner
+struct PawnTerms
+{
+    int         doubled[2];
+    int         isolated[2];
+    int         backward[2];
+    int         passed[2][8];   // by rank counted from the pawn's own side
+};
+
+// Fills entry from scratch, and terms with the counts behind it when asked
+void analysePawns(const Position& position, PawnEntry& entry, PawnTerms* terms = nullptr);
+
+// Shield pawns in front of white's king less those in front of black's, each worth
+// KingShieldPawn: the shield masks only need the kings added
+int kingShieldPawns(const Position& position, const PawnEntry& entry);
+
+class PawnTable
+{
+public:
+    explicit PawnTable(int entries = 16384);
+
+    // The entry for position's pawns, analysed first if it was not in the table
+    const PawnEntry& probe(const Position& position);
+
+    uint64_t probes() const { return _probes; }
+    uint64_t hits() const { return _hits; }
+    void resetCounters() { _probes = _hits = 0; }
+
+private:
+    std::vector<PawnEntry>  _entries;
+    uint64_t                _mask;
+    uint64_t                _probes = 0;
+    uint64_t                _hits = 0;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ChessPiece.h"
+#include "EvalWeights.h"
+
+//
+// material plus placement for every piece on every square, as Position keeps it summed:
+// [color][ChessPiece][square], squares numbered a1 = 0 like the bitboards, scores from white's
+// point of view so black's entries are white's mirrored top to bottom and negated.
+// Built at compile time from EvalWeights.h
+//
+
+struct PieceSquareTables {
+    int16_t     midgame[2][7][64];
+    int16_t     endgame[2][7][64];
+};
+
+constexpr PieceSquareTables makePieceSquareTables()
+{
+    PieceSquareTables tables{};
+    for (int piece = Pawn; piece <= King; piece++) {
+        for (int square = 0; square < 64; square++) {
+            // the weight tables start from a8, white's square a1 is their row 7
+            int whiteIndex = square ^ 56;
+            int blackIndex = square;
+            tables.midgame[0][piece][square] = int16_t(MidgameValue[piece] + MidgameTable[piece][whiteIndex]);
+            tables.endgame[0][piece][square] = int16_t(EndgameValue[piece] + EndgameTable[piece][whiteIndex]);
+            tables.midgame[1][piece][square] = int16_t(-(MidgameValue[piece] + MidgameTable[piece][blackIndex]));
+            tables.endgame[1][piece][square] = int16_t(-(EndgameValue[piece] + EndgameTable[piece][blackIndex]));
+        }
+    }
+    return tables;
+}
+
+inline constexpr PieceSquareTables PieceSquare = makePieceSquareTables();
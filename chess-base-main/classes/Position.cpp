@@ -0,0 +1,411 @@
+#include "Position.h"
+#include <cstdio>
+
+// Rights that survive a move touching each square: moving a king or rook,
+// or capturing a rook on its home square, clears the matching rights
+static const uint8_t castlingMask[64] = {
+    0xFF & ~WhiteQueenside, 0xFF, 0xFF, 0xFF, 0xFF & ~(WhiteKingside | WhiteQueenside), 0xFF, 0xFF, 0xFF & ~WhiteKingside,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF & ~BlackQueenside, 0xFF, 0xFF, 0xFF, 0xFF & ~(BlackKingside | BlackQueenside), 0xFF, 0xFF, 0xFF & ~BlackKingside
+};
+
+void Position::clear()
+{
+    for (int color = 0; color < 2; color++) {
+        for (int piece = 0; piece < 7; piece++) {
+            pieces[color][piece] = 0;
+        }
+    }
+    for (int square = 0; square < 64; square++) {
+        board[square] = 0;
+    }
+    key = 0;
+    pawnKey = 0;
+    materialKey = 0;
+    midgame = 0;
+    endgame = 0;
+    phase = 0;
+    sideToMove = White;
+    castling = 0;
+    epSquare = NoSquare;
+    halfmoveClock = 0;
+    fullmoveNumber = 1;
+    cached = 0;
+}
+
+// FEN letter -> mailbox gameTag, 0 for anything that is not a piece
+static constexpr auto makeFENPieceTable()
+{
+    struct { uint8_t tags[256]; } table{};
+    const char* letters = "PNBRQK";
+    const char* lower = "pnbrqk";
+    for (int i = 0; i < 6; i++) {
+        table.tags[(unsigned char)letters[i]] = uint8_t(Pawn + i);
+        table.tags[(unsigned char)lower[i]] = uint8_t(Pawn + i + 128);
+    }
+    return table;
+}
+static constexpr auto fenPieces = makeFENPieceTable();
+
+// Reads an unsigned number starting at i, leaves i just past it. The number must fit the
+// 16-bit move counters and end at a space or the end of the text
+static bool parseNumber(std::string_view text, size_t& i, int& value)
+{
+    size_t start = i;
+    value = 0;
+    while (i < text.size() && text[i] >= '0' && text[i] <= '9') {
+        value = value * 10 + (text[i] - '0');
+        if (value > UINT16_MAX) {
+            return false;
+        }
+        i++;
+    }
+    return i > start && (i == text.size() || text[i] == ' ');
+}
+
+bool Position::setFEN(std::string_view fen)
+{
+    clear();
+
+    // 1: piece placement, rank 8 first
+    size_t i = 0;
+    int row = 7;
+    int col = 0;
+    for (; i < fen.size() && fen[i] != ' '; i++) {
+        char c = fen[i];
+        if (c == '/') {
+            if (col != 8 || row == 0) {
+                return false;
+            }
+            row--;
+            col = 0;
+        } else if (c >= '1' && c <= '8') {
+            col += c - '0';
+            if (col > 8) {
+                return false;
+            }
+        } else {
+            uint8_t tag = fenPieces.tags[(unsigned char)c];
+            if (!tag || col > 7) {
+                return false;
+            }
+            addPiece(tagColor(tag), tagPiece(tag), row * 8 + col);
+            col++;
+        }
+    }
+    if (row != 0 || col != 8) {
+        return false;
+    }
+
+    // the remaining fields are optional, a bare placement is white to move with no rights
+    auto skipSpaces = [&]() {
+        while (i < fen.size() && fen[i] == ' ') {
+            i++;
+        }
+        return i < fen.size();
+    };
+
+    // 2: active color
+    if (skipSpaces()) {
+        if (fen[i] != 'w' && fen[i] != 'b') {
+            return false;
+        }
+        sideToMove = fen[i] == 'b' ? Black : White;
+        i++;
+    }
+
+    // 3: castling availability
+    if (skipSpaces()) {
+        for (; i < fen.size() && fen[i] != ' '; i++) {
+            switch (fen[i]) {
+                case 'K': castling |= WhiteKingside; break;
+                case 'Q': castling |= WhiteQueenside; break;
+                case 'k': castling |= BlackKingside; break;
+                case 'q': castling |= BlackQueenside; break;
+                case '-': break;
+                default: return false;
+            }
+        }
+    }
+
+    // 4: en passant target square, on the sixth rank of the side to move
+    if (skipSpaces()) {
+        const char epRank = sideToMove == White ? '6' : '3';
+        if (fen[i] == '-') {
+            i++;
+        } else if (i + 1 < fen.size() && fen[i] >= 'a' && fen[i] <= 'h' && fen[i + 1] == epRank) {
+            epSquare = (fen[i + 1] - '1') * 8 + (fen[i] - 'a');
+            i += 2;
+        } else {
+            return false;
+        }
+    }
+
+    // 5 and 6: halfmove clock and fullmove number
+    int number;
+    if (skipSpaces()) {
+        if (!parseNumber(fen, i, number)) {
+            return false;
+        }
+        halfmoveClock = number;
+    }
+    if (skipSpaces()) {
+        if (!parseNumber(fen, i, number)) {
+            return false;
+        }
+        fullmoveNumber = number;
+    }
+    if (skipSpaces()) {
+        return false;
+    }
+
+    // reject what no game can reach and the rest of the engine does not expect: a missing or
+    // extra king, a king that could be captured, pawns on the back ranks, more pawns or pieces
+    // than a side starts with (materialKey has four bits per count), and an en passant square
+    // no double push could have left
+    for (int color = White; color <= Black; color++) {
+        if (std::popcount(pieces[color][King]) != 1 || std::popcount(pieces[color][Pawn]) > 8
+            || std::popcount(pieces[color][NoPiece]) > 16) {
+            return false;
+        }
+    }
+    if ((pieces[White][Pawn] | pieces[Black][Pawn]) & (Rank1 | Rank8)) {
+        return false;
+    }
+    if (epSquare != NoSquare) {
+        // the pawn that double-pushed stands just past the square, which is empty along with
+        // the one it started from
+        const int forward = sideToMove == White ? 8 : -8;
+        const uint64_t crossed = (1ULL << epSquare) | (1ULL << (epSquare + forward));
+        if (!(pieces[sideToMove ^ 1][Pawn] & (1ULL << (epSquare - forward))) || (occupied() & crossed)) {
+            return false;
+        }
+    }
+    if (isSquareAttacked(kingSquare(sideToMove ^ 1), sideToMove)) {
+        return false;
+    }
+    key = computeKey();
+    return true;
+}
+
+int Position::writeFEN(char* buffer) const
+{
+    const char* letters = " PNBRQK";
+    char* out = buffer;
+
+    for (int row = 7; row >= 0; row--) {
+        int empty = 0;
+        for (int col = 0; col < 8; col++) {
+            uint8_t tag = board[row * 8 + col];
+            if (!tag) {
+                empty++;
+                continue;
+            }
+            if (empty) {
+                *out++ = char('0' + empty);
+                empty = 0;
+            }
+            char letter = letters[tagPiece(tag)];
+            *out++ = tagColor(tag) == White ? letter : char(letter - 'A' + 'a');
+        }
+        if (empty) {
+            *out++ = char('0' + empty);
+        }
+        if (row) {
+            *out++ = '/';
+        }
+    }
+
+    *out++ = ' ';
+    *out++ = sideToMove == White ? 'w' : 'b';
+
+    *out++ = ' ';
+    if (!castling) {
+        *out++ = '-';
+    }
+    if (castling & WhiteKingside) *out++ = 'K';
+    if (castling & WhiteQueenside) *out++ = 'Q';
+    if (castling & BlackKingside) *out++ = 'k';
+    if (castling & BlackQueenside) *out++ = 'q';
+
+    *out++ = ' ';
+    if (epSquare == NoSquare) {
+        *out++ = '-';
+    } else {
+        *out++ = char('a' + epSquare % 8);
+        *out++ = char('1' + epSquare / 8);
+    }
+
+    out += snprintf(out, 16, " %u %u", unsigned(halfmoveClock), unsigned(fullmoveNumber));
+    return int(out - buffer);
+}
+
+std::string Position::toFEN() const
+{
+    char buffer[MaxFENLength];
+    int length = writeFEN(buffer);
+    return std::string(buffer, length);
+}
+
+uint64_t Position::computeAttacks(int color) const
+{
+    const uint64_t (&p)[7] = pieces[color];
+    const uint64_t occupancy = occupied() ^ pieces[color ^ 1][King];
+
+    uint64_t attacks = color == White ? shiftUpLeft(p[Pawn]) | shiftUpRight(p[Pawn])
+                                      : shiftDownLeft(p[Pawn]) | shiftDownRight(p[Pawn]);
+    BitBoard(p[Knight]).forEachBit([&](int square) {
+        attacks |= knightAttacks(square);
+    });
+    BitBoard(p[King]).forEachBit([&](int square) {
+        attacks |= kingAttacks(square);
+    });
+    BitBoard(p[Bishop] | p[Queen]).forEachBit([&](int square) {
+        attacks |= bishopAttacks(square, occupancy);
+    });
+    BitBoard(p[Rook] | p[Queen]).forEachBit([&](int square) {
+        attacks |= rookAttacks(square, occupancy);
+    });
+    return attacks;
+}
+
+uint64_t Position::computeKey() const
+{
+    uint64_t hash = 0;
+    for (int square = 0; square < 64; square++) {
+        if (board[square]) {
+            hash ^= Zobrist.pieceSquare[tagColor(board[square])][tagPiece(board[square])][square];
+        }
+    }
+    hash ^= Zobrist.castling[castling];
+    if (epSquare != NoSquare) {
+        hash ^= Zobrist.enPassant[epSquare % 8];
+    }
+    if (sideToMove == Black) {
+        hash ^= Zobrist.side;
+    }
+    return hash;
+}
+
+void Position::makeMove(const BitMove& move, UndoState& undo)
+{
+    const int us = sideToMove;
+    const int them = us ^ 1;
+    const ChessPiece piece = ChessPiece(move.piece);
+
+    undo.key = key;
+    undo.castling = castling;
+    undo.epSquare = epSquare;
+    undo.halfmoveClock = halfmoveClock;
+
+    halfmoveClock++;
+
+    // en passant takes the pawn beside the destination, not on it
+    int captureSquare = move.isEnPassant() ? move.to + (us == White ? -8 : 8) : move.to;
+    undo.captured = board[captureSquare];
+    if (undo.captured) {
+        removePiece(them, tagPiece(undo.captured), captureSquare);
+        halfmoveClock = 0;
+    }
+
+    removePiece(us, piece, move.from);
+    addPiece(us, move.promotion() ? move.promotion() : piece, move.to);
+    if (piece == Pawn) {
+        halfmoveClock = 0;
+    }
+
+    if (move.isCastle()) {
+        bool kingside = move.to > move.from;
+        int rookFrom = kingside ? move.from + 3 : move.from - 4;
+        int rookTo = kingside ? move.from + 1 : move.from - 1;
+        removePiece(us, Rook, rookFrom);
+        addPiece(us, Rook, rookTo);
+    }
+
+    key ^= Zobrist.castling[castling];
+    castling &= castlingMask[move.from] & castlingMask[move.to];
+    key ^= Zobrist.castling[castling];
+
+    if (epSquare != NoSquare) {
+        key ^= Zobrist.enPassant[epSquare % 8];
+    }
+    epSquare = NoSquare;
+    if (move.flags & MoveDoublePush) {
+        epSquare = (move.from + move.to) / 2;
+        key ^= Zobrist.enPassant[epSquare % 8];
+    }
+
+    if (us == Black) {
+        fullmoveNumber++;
+    }
+    sideToMove = them;
+    key ^= Zobrist.side;
+}
+
+void Position::makeNullMove(UndoState& undo)
+{
+    undo.key = key;
+    undo.captured = 0;
+    undo.castling = castling;
+    undo.epSquare = epSquare;
+    undo.halfmoveClock = halfmoveClock;
+
+    if (epSquare != NoSquare) {
+        key ^= Zobrist.enPassant[epSquare % 8];
+        epSquare = NoSquare;
+    }
+    // nothing before a null move can be repeated after it
+    halfmoveClock = 0;
+    sideToMove ^= 1;
+    key ^= Zobrist.side;
+
+    // the attack maps still hold, but the checkers were the other side's
+    cached &= ~CachedCheckers;
+}
+
+void Position::unmakeNullMove(const UndoState& undo)
+{
+    sideToMove ^= 1;
+    epSquare = undo.epSquare;
+    halfmoveClock = undo.halfmoveClock;
+    key = undo.key;
+    cached &= ~CachedCheckers;
+}
+
+void Position::unmakeMove(const BitMove& move, const UndoState& undo)
+{
+    sideToMove ^= 1;
+    const int us = sideToMove;
+    const int them = us ^ 1;
+    const ChessPiece piece = ChessPiece(move.piece);
+
+    if (us == Black) {
+        fullmoveNumber--;
+    }
+
+    if (move.isCastle()) {
+        bool kingside = move.to > move.from;
+        int rookFrom = kingside ? move.from + 3 : move.from - 4;
+        int rookTo = kingside ? move.from + 1 : move.from - 1;
+        removePiece(us, Rook, rookTo);
+        addPiece(us, Rook, rookFrom);
+    }
+
+    removePiece(us, move.promotion() ? move.promotion() : piece, move.to);
+    addPiece(us, piece, move.from);
+
+    if (undo.captured) {
+        int captureSquare = move.isEnPassant() ? move.to + (us == White ? -8 : 8) : move.to;
+        addPiece(them, tagPiece(undo.captured), captureSquare);
+    }
+
+    castling = undo.castling;
+    epSquare = undo.epSquare;
+    halfmoveClock = undo.halfmoveClock;
+    key = undo.key;
+}
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <cstdint>
+#include <bit>
+#include <string>
+#include <string_view>
+#include "BitBoard.h"
+#include "Zobrist.h"
+#include "Attacks.h"
+#include "PieceSquare.h"
+
+//
+// a headless chess position: bitboards plus a mailbox, no Grid, Bit or Sprite objects
+// it is a plain value type (under four cache lines) so search and perft can copy it freely
+// colors match player numbers (white = 0, black = 1)
+//
+
+enum PieceColor
+{
+    White,
+    Black
+};
+
+enum CastlingRights : uint8_t
+{
+    WhiteKingside   = 1,
+    WhiteQueenside  = 2,
+    BlackKingside   = 4,
+    BlackQueenside  = 8
+};
+
+constexpr int NoSquare = 64;
+constexpr int MaxGamePly = 1024;
+constexpr int MaxFENLength = 96;    // longest FEN writeFEN can produce, with its terminator
+
+// Mailbox entries use the same scheme as Bit::gameTag(): piece type (1-6) + 128 for black, 0 for empty
+inline uint8_t pieceTag(int color, ChessPiece piece) { return uint8_t(piece + (color == Black ? 128 : 0)); }
+inline ChessPiece tagPiece(uint8_t tag) { return ChessPiece(tag & 127); }
+inline int tagColor(uint8_t tag) { return tag < 128 ? White : Black; }
+
+// Material keys hold the number of pieces of each type, four bits apiece: white's pawns to
+// queens in the low 20 bits, then black's. Kings are always there and are left out
+constexpr int materialShift(int color, ChessPiece piece) { return (color * 5 + piece - Pawn) * 4; }
+constexpr uint64_t materialUnit(int color, ChessPiece piece) {
+    return piece == NoPiece || piece == King ? 0 : 1ULL << materialShift(color, piece);
+}
+constexpr int materialCount(uint64_t materialKey, int color, ChessPiece piece) {
+    return int(materialKey >> materialShift(color, piece)) & 15;
+}
+
+// Everything makeMove destroys that unmakeMove cannot work out from the move itself
+struct UndoState
+{
+    uint64_t    key;
+    uint8_t     captured;       // gameTag of the captured piece, 0 if none
+    uint8_t     castling;
+    uint8_t     epSquare;
+    uint16_t    halfmoveClock;
+};
+
+// One UndoState per ply played, pushed by makeMove callers and popped on unmake.
+// It holds MaxGamePly states, callers check full() before pushing
+struct UndoStack
+{
+    UndoState   states[MaxGamePly];
+    int         size = 0;
+
+    UndoState& push() { return states[size++]; }
+    const UndoState& pop() { return states[--size]; }
+    const UndoState& top() const { return states[size - 1]; }
+    bool full() const { return size >= MaxGamePly; }
+    void clear() { size = 0; }
+};
+
+// Which of the lazily computed attack queries a Position currently holds
+enum CachedAttacks : uint8_t
+{
+    CachedWhiteAttacks  = 1,
+    CachedBlackAttacks  = 2,
+    CachedCheckers      = 4
+};
+
+struct Position
+{
+    // [color][ChessPiece], the NoPiece slot holds every piece of that color
+    uint64_t    pieces[2][7];
+    uint64_t    key;            // Zobrist hash, updated incrementally
+    uint64_t    pawnKey;        // the same hash over the pawns alone, for the pawn structure table
+    uint64_t    materialKey;    // piece counts, see materialShift, for the endgame and imbalance table
+    uint8_t     board[64];      // gameTag of the piece on each square
+    uint8_t     sideToMove;
+    uint8_t     castling;       // CastlingRights bits
+    uint8_t     epSquare;       // square a pawn can capture onto en passant, NoSquare if none
+    uint16_t    halfmoveClock;  // plies since the last capture or pawn move
+    uint16_t    fullmoveNumber;
+
+    // evaluation sums, updated incrementally like key: material plus piece-square values
+    // for the midgame and the endgame from white's side, and the PhaseWeight of the pieces left
+    int16_t     midgame;
+    int16_t     endgame;
+    uint8_t     phase;
+
+    // attack maps and checkers, filled in on first use and dropped whenever a piece moves
+    mutable uint64_t    attackMap[2];
+    mutable uint64_t    checkerSet;
+    mutable uint8_t     cached;         // CachedAttacks bits that are currently valid
+
+    void clear();
+
+    // Accepts a full FEN or just the piece placement field, returns false if it is malformed
+    // or not a legal position (the side not to move in check, too much material, and so on).
+    // Never allocates, so bulk loaders can call it at memory speed
+    bool setFEN(std::string_view fen);
+    // Writes the full six-field FEN plus a terminator into buffer (MaxFENLength bytes), returns its length
+    int writeFEN(char* buffer) const;
+    std::string toFEN() const;
+
+    // Applies a legal move from generateLegalMoves, saving what unmakeMove needs in undo
+    void makeMove(const BitMove& move, UndoState& undo);
+    // Takes back the last move made, undo must be the state makeMove filled in
+    void unmakeMove(const BitMove& move, const UndoState& undo);
+    // Passes the turn without moving, for null-move pruning; never called while in check
+    void makeNullMove(UndoState& undo);
+    void unmakeNullMove(const UndoState& undo);
+
+    // Hash of the position from scratch, key should always equal this
+    uint64_t computeKey() const;
+
+    void addPiece(int color, ChessPiece piece, int square) {
+        uint64_t squareBit = 1ULL << square;
+        pieces[color][piece] |= squareBit;
+        pieces[color][NoPiece] |= squareBit;
+        board[square] = pieceTag(color, piece);
+        key ^= Zobrist.pieceSquare[color][piece][square];
+        if (piece == Pawn) {
+            pawnKey ^= Zobrist.pieceSquare[color][Pawn][square];
+        }
+        materialKey += materialUnit(color, piece);
+        midgame += PieceSquare.midgame[color][piece][square];
+        endgame += PieceSquare.endgame[color][piece][square];
+        phase += PhaseWeight[piece];
+        cached = 0;
+    }
+
+    void removePiece(int color, ChessPiece piece, int square) {
+        uint64_t squareBit = 1ULL << square;
+        pieces[color][piece] &= ~squareBit;
+        pieces[color][NoPiece] &= ~squareBit;
+        board[square] = 0;
+        key ^= Zobrist.pieceSquare[color][piece][square];
+        if (piece == Pawn) {
+            pawnKey ^= Zobrist.pieceSquare[color][Pawn][square];
+        }
+        materialKey -= materialUnit(color, piece);
+        midgame -= PieceSquare.midgame[color][piece][square];
+        endgame -= PieceSquare.endgame[color][piece][square];
+        phase -= PhaseWeight[piece];
+        cached = 0;
+    }
+
+    uint8_t pieceOn(int square) const { return board[square]; }
+    uint64_t occupied() const { return pieces[White][NoPiece] | pieces[Black][NoPiece]; }
+    uint64_t colorPieces(int color) const { return pieces[color][NoPiece]; }
+    int kingSquare(int color) const { return std::countr_zero(pieces[color][King]); }
+
+    //
+    // Attack queries. The per-side maps and the checkers are computed once per node and
+    // kept with the position, so legality, move ordering and evaluation all share them.
+    // The cache is mutable: a Position may be read by one thread at a time, copies are free
+    // to go their own way. Code that edits the fields directly (e.g. flipping sideToMove for
+    // a null move) must reset cached itself
+    //
+
+    // Every piece of either color that attacks square with the given occupancy
+    uint64_t attackersTo(int square, uint64_t occupancy) const {
+        uint64_t rooksQueens = pieces[White][Rook] | pieces[White][Queen] | pieces[Black][Rook] | pieces[Black][Queen];
+        uint64_t bishopsQueens = pieces[White][Bishop] | pieces[White][Queen] | pieces[Black][Bishop] | pieces[Black][Queen];
+        return (pawnAttacks(Black, square) & pieces[White][Pawn])
+             | (pawnAttacks(White, square) & pieces[Black][Pawn])
+             | (knightAttacks(square) & (pieces[White][Knight] | pieces[Black][Knight]))
+             | (kingAttacks(square) & (pieces[White][King] | pieces[Black][King]))
+             | (rookAttacks(square, occupancy) & rooksQueens)
+             | (bishopAttacks(square, occupancy) & bishopsQueens);
+    }
+    uint64_t attackersTo(int square) const { return attackersTo(square, occupied()); }
+
+    // Cheapest pieces are tried first so the common "yes" answers return early
+    bool isSquareAttacked(int square, int byColor) const {
+        const uint64_t (&p)[7] = pieces[byColor];
+        if ((pawnAttacks(byColor ^ 1, square) & p[Pawn]) || (knightAttacks(square) & p[Knight])
+            || (kingAttacks(square) & p[King])) {
+            return true;
+        }
+        uint64_t occupancy = occupied();
+        return (rookAttacks(square, occupancy) & (p[Rook] | p[Queen]))
+            || (bishopAttacks(square, occupancy) & (p[Bishop] | p[Queen]));
+    }
+
+    // Every square color attacks. The other side's king does not block sliders, so the map
+    // also answers "where can that king go" without stepping back along a checking ray
+    uint64_t attackedBy(int color) const {
+        if (!(cached & (CachedWhiteAttacks << color))) {
+            attackMap[color] = computeAttacks(color);
+            cached |= CachedWhiteAttacks << color;
+        }
+        return attackMap[color];
+    }
+
+    // Enemy pieces giving check to the side to move
+    uint64_t checkers() const {
+        if (!(cached & CachedCheckers)) {
+            checkerSet = pieces[sideToMove][King]
+                ? attackersTo(kingSquare(sideToMove)) & colorPieces(sideToMove ^ 1) : 0;
+            cached |= CachedCheckers;
+        }
+        return checkerSet;
+    }
+    bool inCheck() const { return checkers() != 0; }
+
+    uint64_t computeAttacks(int color) const;
+};
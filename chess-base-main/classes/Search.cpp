@@ -0,0 +1,683 @@
+#include "Search.h"
+#include "Evaluate.h"
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <thread>
+
+// Mate scores are stored relative to the node rather than the root,
+// so a mate found through a transposition keeps the right distance
+static int scoreToTable(int score, int ply)
+{
+    return score >= ScoreMateInMaxPly ? score + ply : score <= -ScoreMateInMaxPly ? score - ply : score;
+}
+
+static int scoreFromTable(int score, int ply)
+{
+    return score >= ScoreMateInMaxPly ? score - ply : score <= -ScoreMateInMaxPly ? score + ply : score;
+}
+
+constexpr int HistoryMax = 16384;
+
+// A capture that leaves the side to move this far short of alpha even after winning the
+// piece outright is not searched in quiescence
+constexpr int DeltaMargin = 200;
+
+// [depth][move number] plies a late quiet move is reduced by, growing with the log of both
+// so the reduction climbs quickly at first and then levels off
+static const auto LateMoveReductions = [] {
+    struct { uint8_t plies[64][64]; } table = {};
+    for (int depth = 1; depth < 64; depth++) {
+        for (int moveCount = 1; moveCount < 64; moveCount++) {
+            table.plies[depth][moveCount] = uint8_t(0.75 + std::log(depth) * std::log(moveCount) / 2.25);
+        }
+    }
+    return table;
+}();
+
+// Shallow nodes a static eval this far past the bound is trusted at, per ply of depth left
+constexpr int ReverseFutilityMargin = 80;
+constexpr int FutilityMargin = 100;
+constexpr int MaxPruningDepth = 6;
+
+// Quiet moves searched at a shallow node before the rest are skipped
+static int lateMoveCount(int depth, bool improving)
+{
+    return improving ? 3 + depth * depth : (3 + depth * depth) / 2;
+}
+
+// Null-move pruning is unsound in zugzwang, which without pieces besides pawns is common
+static bool hasNonPawnMaterial(const Position& position)
+{
+    const int us = position.sideToMove;
+    return position.colorPieces(us) != (position.pieces[us][Pawn] | position.pieces[us][King]);
+}
+
+void Search::setThreads(int count)
+{
+    if (count <= 0) {
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (count == threads()) {
+        return;
+    }
+    _workers.clear();
+    for (int i = 0; i < count; i++) {
+        _workers.push_back(std::make_unique<SearchWorker>(*this, i));
+    }
+}
+
+SearchResult Search::think(const Position& position, const SearchLimits& limits, const UndoStack* history)
+{
+    _limits = limits;
+    _stop = false;
+    _pondering = limits.ponderHit && !limits.ponderHit->load();
+    _time.start(limits.clock);
+    _startTime = std::chrono::steady_clock::now();
+    _table.newSearch();
+
+    uint64_t keys[MaxGamePly + 1];
+    int keyCount = 0;
+    if (history) {
+        // only positions since the last capture or pawn move can repeat, and never more than
+        // the array holds
+        const int first = std::max(0, history->size - std::min(int(position.halfmoveClock), MaxGamePly));
+        for (int i = first; i < history->size; i++) {
+            keys[keyCount++] = history->states[i].key;
+        }
+    }
+    keys[keyCount++] = position.key;
+
+    MoveList rootMoves;
+    generateLegalMoves(position, rootMoves);
+    if (rootMoves.empty()) {
+        return SearchResult();
+    }
+    _multiPV = std::clamp(limits.multiPV, 1, rootMoves.size());
+    // the game went the way the last search expected, so its line is the best first guess
+    BitMove expected{};
+    for (int i = 0; i < _lineLength; i++) {
+        if (_lineKeys[i] == position.key) {
+            expected = _lineMoves[i];
+            break;
+        }
+    }
+    for (auto& worker : _workers) {
+        worker->start(position, keys, keyCount);
+        worker->_rootBest = expected;
+        // something legal to play even if the very first iteration gets cut short
+        worker->_result.bestMove = rootMoves[0];
+    }
+
+    // the main thread searches on the caller's thread and stops the helpers when it is done
+    std::vector<std::thread> helpers;
+    for (size_t i = 1; i < _workers.size(); i++) {
+        helpers.emplace_back(&SearchWorker::iterate, _workers[i].get());
+    }
+    _workers[0]->iterate();
+    _stop = true;
+    for (std::thread& helper : helpers) {
+        helper.join();
+    }
+
+    // a helper that completed a deeper iteration than the main thread has the better answer
+    const SearchWorker* best = _workers[0].get();
+    for (auto& worker : _workers) {
+        if (worker->_result.depth > best->_result.depth) {
+            best = worker.get();
+        }
+    }
+    SearchResult result = best->_result;
+    result.nodes = 0;
+    for (auto& worker : _workers) {
+        result.nodes += worker->_nodes;
+        result.pawnProbes += worker->_pawnTable.probes();
+        result.pawnHits += worker->_pawnTable.hits();
+    }
+    result.timeMs = elapsedMs();
+    rememberLine(position, result);
+    return result;
+}
+
+void Search::rememberLine(const Position& position, const SearchResult& result)
+{
+    Position walk = position;
+    _lineLength = 0;
+    for (int i = 0; i < result.pvLength; i++) {
+        _lineKeys[_lineLength] = walk.key;
+        _lineMoves[_lineLength++] = result.pv[i];
+        UndoState undo;
+        walk.makeMove(result.pv[i], undo);
+    }
+}
+
+void SearchWorker::start(const Position& position, const uint64_t* keys, int keyCount)
+{
+    _position = position;
+    if (_search.network) {
+        _search.network->refresh(_position, _accumulators[0]);
+        _accumulatorReady[0] = true;
+    }
+    std::copy(keys, keys + keyCount, _keys);
+    _keyCount = keyCount;
+    _nodes = 0;
+    _publishedNodes = 0;
+    _pawnTable.resetCounters();
+    _rootDepth = 0;
+    _rootBest = BitMove{};
+    _result = SearchResult();
+    std::fill(&_killers[0][0], &_killers[0][0] + MaxPly * 2, BitMove{});
+
+    // what was learned last move still mostly holds, but should give way to the new position
+    for (auto& fromTable : _history) {
+        for (auto& toTable : fromTable) {
+            for (int& score : toTable) {
+                score /= 2;
+            }
+        }
+    }
+}
+
+void SearchWorker::iterate()
+{
+    int score = 0;
+    for (int depth = 1; depth <= _search.depthLimit() && depth < MaxPly; depth++) {
+        // odd helpers run a ply ahead of the main thread so the threads spread over two depths,
+        // but never past the depth limit, a depth-limited search must not answer from deeper
+        _rootDepth = std::min({ depth + (_id & 1), _search.depthLimit(), MaxPly - 1 });
+
+        std::vector<SearchLine> lines;
+        _rootExcludedCount = 0;
+        for (int pvIndex = 0; pvIndex < _search._multiPV; pvIndex++) {
+            // each line starts from the move and score it had last iteration
+            const bool hadLine = pvIndex < int(_result.lines.size());
+            if (hadLine) {
+                _rootBest = _result.lines[pvIndex].pv[0];
+            } else if (pvIndex > 0) {
+                _rootBest = BitMove{};
+            }
+            score = aspiration(_rootDepth, hadLine ? _result.lines[pvIndex].score : score);
+            if (_search._stop) {
+                break;
+            }
+
+            SearchLine& line = lines.emplace_back();
+            line.score = score;
+            line.depth = _rootDepth;
+            line.pvLength = _pvLength[0];
+            std::copy(_pv[0], _pv[0] + _pvLength[0], line.pv);
+            _rootExcluded[_rootExcludedCount++] = _pv[0][0];
+        }
+        _rootExcludedCount = 0;
+        if (_search._stop) {
+            break;
+        }
+
+        // a later line can come out ahead of an earlier one that failed low
+        std::stable_sort(lines.begin(), lines.end(), [](const SearchLine& a, const SearchLine& b) {
+            return a.score > b.score;
+        });
+        const SearchLine& best = lines[0];
+        score = best.score;
+        _rootBest = best.pv[0];
+        _result.bestMove = best.pv[0];
+        _result.score = best.score;
+        _result.depth = _rootDepth;
+        _result.pvLength = best.pvLength;
+        std::copy(best.pv, best.pv + best.pvLength, _result.pv);
+        _result.lines = std::move(lines);
+        if (_id == 0 && _search.onIteration) {
+            _result.nodes = _search.nodes();
+            _result.timeMs = _search.elapsedMs();
+            _search.onIteration(_result);
+        }
+        if (_id == 0 && !_search._pondering && _search._time.iterationDone(_result.bestMove, score, _search.elapsedMs())) {
+            break;
+        }
+
+        // a mate inside the horizon cannot be improved on by searching deeper, though the
+        // other lines of a multi-PV search still can
+        if (_search._multiPV == 1 && std::abs(score) >= ScoreMateInMaxPly && ScoreMate - std::abs(score) <= _rootDepth) {
+            break;
+        }
+    }
+}
+
+// Searches a narrow window around the last iteration's score first, which cuts far more of
+// the tree; a result outside the window is searched again with that side widened
+int SearchWorker::aspiration(int depth, int previousScore)
+{
+    int delta = 25;
+    int alpha = -ScoreInfinite;
+    int beta = ScoreInfinite;
+    if (depth >= 4 && std::abs(previousScore) < ScoreMateInMaxPly) {
+        alpha = std::max(previousScore - delta, -ScoreInfinite);
+        beta = std::min(previousScore + delta, ScoreInfinite);
+    }
+
+    while (true) {
+        int score = negamax(depth, alpha, beta, 0);
+        if (_search._stop) {
+            return score;
+        }
+        if (score <= alpha) {
+            beta = (alpha + beta) / 2;
+            alpha = std::max(score - delta, -ScoreInfinite);
+        } else if (score >= beta) {
+            beta = std::min(score + delta, ScoreInfinite);
+        } else {
+            return score;
+        }
+        delta += delta / 2;
+    }
+}
+
+// Principal variation search: the first move gets the full window, every later one a null
+// window that only proves it is no better, re-searched in full if that proof fails
+int SearchWorker::negamax(int depth, int alpha, int beta, int ply)
+{
+    _pvLength[ply] = ply;
+    if ((++_nodes & 1023) == 0) {
+        _publishedNodes.store(_nodes, std::memory_order_relaxed);
+        if (_id == 0) {
+            _search.checkLimits(*this);
+        }
+    }
+    if (_search._stop) {
+        return 0;
+    }
+
+    if (ply > 0) {
+        if (_position.halfmoveClock >= 100 || isRepetition()) {
+            return ScoreDraw;
+        }
+        if (ply >= MaxPly - 1) {
+            return evaluate(ply);
+        }
+        // no line from here can beat a mate already found nearer the root
+        alpha = std::max(alpha, -ScoreMate + ply);
+        beta = std::min(beta, ScoreMate - ply - 1);
+        if (alpha >= beta) {
+            return alpha;
+        }
+    }
+
+    // never stop the search while in check
+    const bool inCheck = _position.inCheck();
+    if (inCheck) {
+        depth++;
+    }
+    if (depth <= 0) {
+        return quiescence(alpha, beta, ply);
+    }
+
+    // a deep enough stored result settles the node outright, except on the principal
+    // variation where it would cut the line short
+    const bool pvNode = beta - alpha > 1;
+    TTData hit;
+    const bool ttHit = _search._table.probe(_position.key, hit);
+    if (ttHit && !pvNode && hit.depth >= depth) {
+        int score = scoreFromTable(hit.score, ply);
+        if (hit.bound == BoundExact || (hit.bound == BoundLower && score >= beta) || (hit.bound == BoundUpper && score <= alpha)) {
+            return score;
+        }
+    }
+
+    // what the side to move has without searching, and whether that is better than two plies ago
+    const SearchFeatures& features = _search.features;
+    const int staticEval = inCheck ? -ScoreInfinite : evaluate(ply);
+    _evalStack[ply] = staticEval;
+    const bool improving = !inCheck && ply >= 2 && staticEval > _evalStack[ply - 2];
+
+    if (!pvNode && !inCheck) {
+        // reverse futility: this far above beta a shallow search will not come back down
+        if (features.reverseFutility && depth <= MaxPruningDepth && std::abs(beta) < ScoreMateInMaxPly
+            && staticEval - ReverseFutilityMargin * (depth - improving) >= beta) {
+            return staticEval;
+        }
+
+        // null move: if passing still leaves us above beta, a real move will too. Never twice
+        // in a row, and the reduction grows with depth and with how far the eval is above beta
+        if (features.nullMove && depth >= 3 && staticEval >= beta && ply > 0 && !(_moveStack[ply - 1] == BitMove{})
+            && hasNonPawnMaterial(_position)) {
+            const int reduction = 3 + depth / 4 + std::min((staticEval - beta) / 200, 3);
+            UndoState undo;
+            makeNullMove(undo, ply);
+            _keys[_keyCount++] = _position.key;
+            _moveStack[ply] = BitMove{};
+            int score = -negamax(depth - 1 - reduction, -beta, -beta + 1, ply + 1);
+            _keyCount--;
+            _position.unmakeNullMove(undo);
+            if (_search._stop) {
+                return 0;
+            }
+            if (score >= beta) {
+                // a mate found after passing proves nothing about the real moves
+                return score >= ScoreMateInMaxPly ? beta : score;
+            }
+        }
+    }
+
+    BitMove hashMove = ply == 0 && !(_rootBest == BitMove{}) ? _rootBest : ttHit ? hit.move : BitMove{};
+    BitMove counterMove{};
+    if (ply > 0) {
+        const BitMove& previous = _moveStack[ply - 1];
+        counterMove = _counterMoves[_position.sideToMove ^ 1][previous.piece][previous.to];
+    }
+    MovePicker picker(_position, hashMove, _killers[ply], counterMove, _history);
+
+    const int originalAlpha = alpha;
+    int bestScore = -ScoreInfinite;
+    BitMove bestMove{};
+    BitMove quietsTried[64];
+    int quietCount = 0;
+    int moveCount = 0;
+    for (BitMove move = picker.next(); !(move == BitMove{}); move = picker.next()) {
+        if (ply == 0 && isExcludedAtRoot(move)) {
+            continue;
+        }
+        const bool quiet = !move.isCapture() && !move.promotion();
+        moveCount++;
+
+        UndoState undo;
+        makeMove(move, undo, ply);
+        const bool givesCheck = _position.inCheck();
+
+        // shallow quiet moves that cannot matter, once some move has kept us out of a mate.
+        // Checks are kept, they are how a side that is behind gets back into the game
+        if (!pvNode && !inCheck && quiet && !givesCheck && depth <= MaxPruningDepth && bestScore > -ScoreMateInMaxPly
+            && ((features.lateMovePruning && quietCount >= lateMoveCount(depth, improving))
+                || (features.futility && staticEval + FutilityMargin * (depth + 1) <= alpha))) {
+            _position.unmakeMove(move, undo);
+            continue;
+        }
+
+        _keys[_keyCount++] = _position.key;
+        _moveStack[ply] = move;
+
+        int score;
+        if (moveCount == 1) {
+            score = -negamax(depth - 1, -beta, -alpha, ply + 1);
+        } else {
+            // late quiet moves are searched shallower first, and only at full depth if that beats alpha
+            int reduction = 0;
+            if (features.lateMoveReductions && quiet && depth >= 3 && moveCount > 1 + pvNode && !inCheck && !givesCheck) {
+                reduction = LateMoveReductions.plies[std::min(depth, 63)][std::min(moveCount, 63)];
+                reduction += !pvNode;
+                reduction -= _killers[ply][0] == move || _killers[ply][1] == move || counterMove == move;
+                reduction -= _history[_position.sideToMove ^ 1][move.from][move.to] / 8192;
+                reduction = std::clamp(reduction, 0, depth - 2);
+            }
+            score = -negamax(depth - 1 - reduction, -alpha - 1, -alpha, ply + 1);
+            if (reduction > 0 && score > alpha) {
+                score = -negamax(depth - 1, -alpha - 1, -alpha, ply + 1);
+            }
+            if (score > alpha && score < beta) {
+                score = -negamax(depth - 1, -beta, -alpha, ply + 1);
+            }
+        }
+
+        _keyCount--;
+        _position.unmakeMove(move, undo);
+        if (_search._stop) {
+            return 0;
+        }
+
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) {
+                alpha = score;
+                bestMove = move;
+                _pv[ply][ply] = move;
+                std::copy(_pv[ply + 1] + ply + 1, _pv[ply + 1] + _pvLength[ply + 1], _pv[ply] + ply + 1);
+                _pvLength[ply] = std::max(_pvLength[ply + 1], ply + 1);
+                if (alpha >= beta) {
+                    if (quiet) {
+                        updateQuietStats(move, depth, ply, quietsTried, quietCount);
+                    }
+                    break;
+                }
+            }
+        }
+        if (quiet && quietCount < 64) {
+            quietsTried[quietCount++] = move;
+        }
+    }
+
+    if (moveCount == 0) {
+        return inCheck ? -ScoreMate + ply : ScoreDraw;
+    }
+
+    // with root moves left out the root's result is not the position's
+    if (ply > 0 || !_rootExcludedCount) {
+        Bound bound = bestScore >= beta ? BoundLower : bestScore > originalAlpha ? BoundExact : BoundUpper;
+        _search._table.store(_position.key, bestMove, scoreToTable(bestScore, ply), depth, bound);
+    }
+    return bestScore;
+}
+
+// Searches only captures and promotions until the position is quiet. The side to move may
+// stand pat on the static evaluation instead of capturing, except in check, where every
+// evasion is searched so mates are still seen
+int SearchWorker::quiescence(int alpha, int beta, int ply)
+{
+    _pvLength[ply] = ply;
+    if ((++_nodes & 1023) == 0) {
+        _publishedNodes.store(_nodes, std::memory_order_relaxed);
+        if (_id == 0) {
+            _search.checkLimits(*this);
+        }
+    }
+    if (_search._stop) {
+        return 0;
+    }
+    if (ply >= MaxPly - 1) {
+        return evaluate(ply);
+    }
+
+    const bool pvNode = beta - alpha > 1;
+    TTData hit;
+    const bool ttHit = _search._table.probe(_position.key, hit);
+    if (ttHit && !pvNode) {
+        int score = scoreFromTable(hit.score, ply);
+        if (hit.bound == BoundExact || (hit.bound == BoundLower && score >= beta) || (hit.bound == BoundUpper && score <= alpha)) {
+            return score;
+        }
+    }
+
+    const int originalAlpha = alpha;
+    const bool inCheck = _position.inCheck();
+    int standPat = -ScoreInfinite;
+    int bestScore = -ScoreInfinite;
+    if (!inCheck) {
+        standPat = evaluate(ply);
+        if (standPat >= beta) {
+            return standPat;
+        }
+        alpha = std::max(alpha, standPat);
+        bestScore = standPat;
+    }
+
+    MovePicker picker(_position, ttHit ? hit.move : BitMove{}, _history);
+    BitMove bestMove{};
+    int moveCount = 0;
+    for (BitMove move = picker.next(); !(move == BitMove{}); move = picker.next()) {
+        moveCount++;
+
+        // delta pruning: winning this piece cannot bring the score back up to alpha
+        if (!inCheck && !move.promotion()) {
+            int victim = move.flags & MoveEnPassant ? Pawn : tagPiece(_position.pieceOn(move.to));
+            if (standPat + PieceValue[victim] + DeltaMargin <= alpha) {
+                continue;
+            }
+        }
+
+        UndoState undo;
+        makeMove(move, undo, ply);
+        int score = -quiescence(-beta, -alpha, ply + 1);
+        _position.unmakeMove(move, undo);
+        if (_search._stop) {
+            return 0;
+        }
+
+        if (score > bestScore) {
+            bestScore = score;
+            if (score > alpha) {
+                alpha = score;
+                bestMove = move;
+                _pv[ply][ply] = move;
+                std::copy(_pv[ply + 1] + ply + 1, _pv[ply + 1] + _pvLength[ply + 1], _pv[ply] + ply + 1);
+                _pvLength[ply] = std::max(_pvLength[ply + 1], ply + 1);
+                if (alpha >= beta) {
+                    break;
+                }
+            }
+        }
+    }
+
+    if (inCheck && moveCount == 0) {
+        return -ScoreMate + ply;
+    }
+
+    Bound bound = bestScore >= beta ? BoundLower : bestScore > originalAlpha ? BoundExact : BoundUpper;
+    _search._table.store(_position.key, bestMove, scoreToTable(bestScore, ply), 0, bound);
+    return bestScore;
+}
+
+// A position repeated since the last capture or pawn move is scored as a draw straight away:
+// if repeating was good for one side it will repeat again
+bool SearchWorker::isRepetition() const
+{
+    const uint64_t key = _keys[_keyCount - 1];
+    const int earliest = std::max(0, _keyCount - 1 - _position.halfmoveClock);
+    for (int i = _keyCount - 3; i >= earliest; i -= 2) {
+        if (_keys[i] == key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Every move the search makes goes through here, so the next node's table entry is on its way
+// and its accumulator knows how to catch up
+void SearchWorker::makeMove(const BitMove& move, UndoState& undo, int ply)
+{
+    if (_search.network) {
+        _accumulatorDeltas[ply + 1] = featureDelta(_position, move);
+        _accumulatorReady[ply + 1] = false;
+    }
+    _position.makeMove(move, undo);
+    _search._table.prefetch(_position.key);
+}
+
+void SearchWorker::makeNullMove(UndoState& undo, int ply)
+{
+    if (_search.network) {
+        _accumulatorDeltas[ply + 1] = FeatureDelta();
+        _accumulatorReady[ply + 1] = false;
+    }
+    _position.makeNullMove(undo);
+    _search._table.prefetch(_position.key);
+}
+
+int SearchWorker::evaluate(int ply)
+{
+    if (_search.network) {
+        // the network does not know the endgames the material table has an answer for
+        const MaterialEntry& material = _materialTable.probe(_position);
+        if (material.evaluator) {
+            return material.evaluate(_position);
+        }
+        return _search.network->evaluate(accumulator(ply), _position.sideToMove);
+    }
+    return ::evaluate(_position, &_pawnTable, &_materialTable);
+}
+
+// Catches up from the nearest ready ancestor, the root always is
+const Accumulator& SearchWorker::accumulator(int ply)
+{
+    if (!_accumulatorReady[ply]) {
+        _search.network->update(accumulator(ply - 1), _accumulators[ply], _accumulatorDeltas[ply]);
+        _accumulatorReady[ply] = true;
+    }
+    return _accumulators[ply];
+}
+
+bool SearchWorker::isExcludedAtRoot(const BitMove& move) const
+{
+    return std::find(_rootExcluded, _rootExcluded + _rootExcludedCount, move) != _rootExcluded + _rootExcludedCount;
+}
+
+// A quiet move that cut off becomes a killer for this ply and the counter move to the
+// opponent's last move; its history goes up and the quiets tried before it go down
+void SearchWorker::updateQuietStats(const BitMove& move, int depth, int ply, const BitMove* quietsTried, int quietCount)
+{
+    if (!(_killers[ply][0] == move)) {
+        _killers[ply][1] = _killers[ply][0];
+        _killers[ply][0] = move;
+    }
+    if (ply > 0) {
+        const BitMove& previous = _moveStack[ply - 1];
+        _counterMoves[_position.sideToMove ^ 1][previous.piece][previous.to] = move;
+    }
+
+    int bonus = std::min(depth * depth, 400);
+    updateHistory(move, bonus);
+    for (int i = 0; i < quietCount; i++) {
+        updateHistory(quietsTried[i], -bonus);
+    }
+}
+
+// The update pulls the score towards +-HistoryMax rather than adding to it,
+// so scores stay bounded and recent results count for more
+void SearchWorker::updateHistory(const BitMove& move, int bonus)
+{
+    int& score = _history[_position.sideToMove][move.from][move.to];
+    score += bonus - score * std::abs(bonus) / HistoryMax;
+}
+
+// Depth 1 always completes so there is a move to play
+void Search::checkLimits(const SearchWorker& main)
+{
+    if (_limits.stopRequest && _limits.stopRequest->load(std::memory_order_relaxed)) {
+        _stop = true;
+    }
+    if (_pondering) {
+        if (!_limits.ponderHit->load(std::memory_order_relaxed)) {
+            return;
+        }
+        // the expected move was played: from here on this is an ordinary search
+        _pondering = false;
+        _startTime = std::chrono::steady_clock::now();
+        if (main._result.depth >= _limits.depth) {
+            _stop = true;
+        }
+    }
+    if (main._rootDepth <= 1) {
+        return;
+    }
+    if (_limits.nodes && nodes() >= _limits.nodes) {
+        _stop = true;
+    }
+    if (_limits.moveTimeMs && elapsedMs() >= _limits.moveTimeMs) {
+        _stop = true;
+    }
+    if (_time.hardLimitReached(elapsedMs())) {
+        _stop = true;
+    }
+}
+
+// Every thread's count as of its last publish, close enough to enforce a node limit
+uint64_t Search::nodes() const
+{
+    uint64_t total = 0;
+    for (auto& worker : _workers) {
+        total += worker->_publishedNodes.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+int Search::elapsedMs() const
+{
+    return int(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _startTime).count());
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "MovePicker.h"
+#include "Material.h"
+#include "NNUE.h"
+#include "Pawns.h"
+#include "TimeManager.h"
+#include "TranspositionTable.h"
+
+//
+// iterative deepening principal variation search over a headless Position
+// scores are centipawns from the side to move's point of view, mates are ScoreMate minus the
+// distance in plies so a shorter mate always scores higher
+//
+// Lazy SMP: every thread searches the same root on its own copy of the position, with its own
+// killer, counter move and history tables, and they share only the transposition table. Helpers search some depths a ply
+// deeper than the main thread, so what one thread stores is found by the others and the search
+// as a whole gets deeper sooner
+//
+// multi-PV: each iteration searches the root once per line, every search leaving out the root
+// moves the lines before it took, so the N best moves all get exact scores from one search
+//
+// at the horizon a quiescence search plays out the captures still pending, so no position is
+// scored in the middle of an exchange
+//
+
+constexpr int MaxPly = 128;
+constexpr int ScoreDraw = 0;
+constexpr int ScoreMate = 32000;
+constexpr int ScoreMateInMaxPly = ScoreMate - MaxPly;   // anything beyond this is a forced mate
+constexpr int ScoreInfinite = 32001;
+
+// When to stop. Depth always applies, nodes and time only when non-zero
+struct SearchLimits
+{
+    int         depth = MaxPly - 1;     // deepest iteration to start
+    uint64_t    nodes = 0;              // stop after this many nodes, counted over every thread
+    int         moveTimeMs = 0;         // stop after this many milliseconds
+    TimeControl clock;                  // the side to move's clock, budgeted by a TimeManager
+    int         multiPV = 1;            // root moves to find an exact score and full line for
+    const std::atomic<bool>* stopRequest = nullptr;     // polled, the search winds down once it is set
+    // Pondering: while this points at false the search ignores every limit but stopRequest.
+    // Once it is set the other limits apply, with the clock started at that moment
+    const std::atomic<bool>* ponderHit = nullptr;
+};
+
+// Selective search, each part can be switched off to measure what it is worth
+struct SearchFeatures
+{
+    bool        nullMove = true;            // let the opponent move twice, a position still above beta is cut
+    bool        lateMoveReductions = true;  // search late quiet moves shallower, re-searching any that beat alpha
+    bool        reverseFutility = true;     // cut a shallow node whose static eval is far above beta
+    bool        futility = true;            // skip quiet moves at shallow nodes whose eval is far below alpha
+    bool        lateMovePruning = true;     // skip the last quiet moves at shallow nodes outright
+};
+
+// One root move and the line the search expects after it
+struct SearchLine
+{
+    int         score = 0;
+    int         depth = 0;
+    BitMove     pv[MaxPly];
+    int         pvLength = 0;
+};
+
+// The last completed iteration
+struct SearchResult
+{
+    BitMove     bestMove{};             // all zero when there was nothing to play
+    int         score = 0;
+    int         depth = 0;
+    uint64_t    nodes = 0;
+    uint64_t    pawnProbes = 0;         // pawn table lookups over every thread, and how many found their entry
+    uint64_t    pawnHits = 0;
+    int         timeMs = 0;
+    BitMove     pv[MaxPly];
+    int         pvLength = 0;
+    std::vector<SearchLine> lines;      // the SearchLimits::multiPV best root moves, best first
+};
+
+class Search;
+
+// One searching thread: a private copy of the position and its tables
+class SearchWorker
+{
+public:
+    SearchWorker(Search& search, int id) : _search(search), _id(id) { }
+
+private:
+    friend class Search;
+
+    void start(const Position& position, const uint64_t* keys, int keyCount);
+    void iterate();
+    int aspiration(int depth, int previousScore);
+    int negamax(int depth, int alpha, int beta, int ply);
+    int quiescence(int alpha, int beta, int ply);
+    bool isRepetition() const;
+    bool isExcludedAtRoot(const BitMove& move) const;
+    void makeMove(const BitMove& move, UndoState& undo, int ply);
+    void makeNullMove(UndoState& undo, int ply);
+    int evaluate(int ply);
+    const Accumulator& accumulator(int ply);
+    void updateQuietStats(const BitMove& move, int depth, int ply, const BitMove* quietsTried, int quietCount);
+    void updateHistory(const BitMove& move, int bonus);
+
+    Search&                 _search;
+    const int               _id;                // 0 is the main thread, which watches the limits
+    Position                _position;
+    uint64_t                _nodes = 0;
+    std::atomic<uint64_t>   _publishedNodes{0}; // _nodes as of the last limit check, for the other threads
+    int                     _rootDepth = 0;
+    BitMove                 _rootBest{};        // best move of the last completed iteration, searched first at the root
+    BitMove                 _rootExcluded[MaxMoves];    // multi-PV: root moves that already have a line this iteration
+    int                     _rootExcludedCount = 0;
+    SearchResult            _result;
+
+    // keys of every position from the start of the game down to the current node
+    uint64_t                _keys[MaxGamePly + MaxPly];
+    int                     _keyCount = 0;
+
+    // triangular principal variation table, row ply holds the best line from that ply on
+    BitMove                 _pv[MaxPly][MaxPly];
+    int                     _pvLength[MaxPly];
+
+    // move ordering: the move made at each ply, two quiet moves per ply that last cut off,
+    // the quiet reply that refuted each [color][piece][to] move, and history scores aged
+    // between searches
+    BitMove                 _moveStack[MaxPly];     // BitMove{} for a null move
+    int                     _evalStack[MaxPly];     // static eval at each ply, -ScoreInfinite when in check
+    BitMove                 _killers[MaxPly][2];
+    BitMove                 _counterMoves[2][7][64] = {};
+    HistoryTable            _history = {};
+
+    // network evaluation: the accumulator at each ply and the move that led to it, brought
+    // up to date from the ply before only when the node is actually evaluated
+    Accumulator             _accumulators[MaxPly + 1];
+    FeatureDelta            _accumulatorDeltas[MaxPly + 1];
+    bool                    _accumulatorReady[MaxPly + 1];
+
+    // pawn structure and material of positions this thread has evaluated, kept between searches
+    PawnTable               _pawnTable;
+    MaterialTable           _materialTable;
+};
+
+class Search
+{
+public:
+    explicit Search(TranspositionTable& table, int threads = 1) : _table(table) { setThreads(threads); }
+
+    // 0 = one per core
+    void setThreads(int count);
+    int threads() const { return int(_workers.size()); }
+
+    // Searches position until the limits run out and returns the best move found.
+    // history holds the moves played to reach position, so repetitions of earlier positions count as draws.
+    // A position on the principal variation of the previous search starts from that line's move
+    SearchResult think(const Position& position, const SearchLimits& limits, const UndoStack* history = nullptr);
+
+    // May be called from any thread while think() runs, the search returns its last completed
+    // iteration. A search started on another thread is better stopped through
+    // SearchLimits::stopRequest, which cannot be missed by a search that has not begun yet
+    void stop() { _stop = true; }
+
+    // Called on the searching thread after every iteration the main thread completes
+    std::function<void(const SearchResult&)> onIteration;
+
+    // Read at the start of every search
+    SearchFeatures features;
+    // Evaluate with this network instead of the hand-written evaluation, nullptr for that
+    const Network* network = nullptr;
+
+private:
+    friend class SearchWorker;
+
+    void checkLimits(const SearchWorker& main);
+    int depthLimit() const { return _pondering.load(std::memory_order_relaxed) ? MaxPly - 1 : _limits.depth; }
+    uint64_t nodes() const;
+    int elapsedMs() const;
+    void rememberLine(const Position& position, const SearchResult& result);
+
+    TranspositionTable&     _table;
+    std::vector<std::unique_ptr<SearchWorker>>  _workers;
+    SearchLimits            _limits;
+    std::chrono::steady_clock::time_point   _startTime;
+    std::atomic<bool>       _stop{false};
+    std::atomic<bool>       _pondering{false};  // waiting on SearchLimits::ponderHit
+    int                     _multiPV = 1;       // lines per iteration, no more than there are root moves
+    TimeManager             _time;              // main thread only
+
+    // the last principal variation and the key of the position each of its moves was played from
+    BitMove                 _lineMoves[MaxPly];
+    uint64_t                _lineKeys[MaxPly];
+    int                     _lineLength = 0;
+};
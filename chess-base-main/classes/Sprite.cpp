@@ -3,6 +3,16 @@
 #include "stb_image.h"
 #include <iostream>
 #include <filesystem>
+#include <string>
+#include <unordered_map>
+
+// Textures are never freed, so every sprite using the same image can share one upload
+// instead of decoding the PNG again (a chess setup creates 32 pieces from 12 images)
+struct CachedTexture {
+    ImTextureID texture;
+    ImVec2      size;
+};
+static std::unordered_map<std::string, CachedTexture> textureCache;
 
 // Simple helper function to load an image into a OpenGL texture with common settings
 bool Sprite::LoadTextureFromFile(const char* filename)
@@ -12,6 +22,12 @@ bool Sprite::LoadTextureFromFile(const char* filename)
     int image_height = 0;
     std::filesystem::path resourcePath = std::filesystem::path("resources") / filename;
     std::string newFilename = resourcePath.string();
+    auto cached = textureCache.find(newFilename);
+    if (cached != textureCache.end()) {
+        _texture = cached->second.texture;
+        _size = cached->second.size;
+        return true;
+    }
     unsigned char* image_data = stbi_load(newFilename.c_str(), &image_width, &image_height, NULL, 4);
     if (image_data == NULL) {
         _size = ImVec2(0, 0);
@@ -25,6 +41,7 @@ bool Sprite::LoadTextureFromFile(const char* filename)
         return false;
     }
     _size = ImVec2((float)image_width, (float)image_height);
+    textureCache[newFilename] = { _texture, _size };
     return true;
 }
 
@@ -0,0 +1,68 @@
+#include "TimeManager.h"
+#include <algorithm>
+
+// Kept back from every move for the GUI and the thread handoff
+constexpr int MoveOverheadMs = 30;
+// Moves the rest of the game is assumed to take when the clock does not say
+constexpr int DefaultMovesToGo = 30;
+
+void TimeManager::start(const TimeControl& clock)
+{
+    _active = clock.timeLeftMs > 0;
+    _bestMove = BitMove{};
+    _stableIterations = 0;
+    _previousScore = 0;
+    _iterations = 0;
+    _lastIterationEndMs = 0;
+    _lastIterationMs = 0;
+    _previousIterationMs = 0;
+    if (!_active) {
+        _softMs = _hardMs = 0;
+        return;
+    }
+
+    const int available = std::max(1, clock.timeLeftMs - MoveOverheadMs);
+    const int movesToGo = clock.movesToGo > 0 ? std::min(clock.movesToGo, 50) : DefaultMovesToGo;
+
+    // an even share of what is left plus most of the increment, and never so much of the
+    // clock on one move that the next ones are starved
+    _hardMs = std::min(available * 4 / 5, (available / movesToGo + clock.incrementMs) * 5);
+    _softMs = std::min(_hardMs, available / movesToGo + clock.incrementMs * 3 / 4);
+    _hardMs = std::max(_hardMs, 1);
+    _softMs = std::max(_softMs, 1);
+}
+
+bool TimeManager::iterationDone(const BitMove& bestMove, int score, int elapsedMs)
+{
+    if (!_active) {
+        return false;
+    }
+
+    _stableIterations = bestMove == _bestMove ? _stableIterations + 1 : 0;
+    _bestMove = bestMove;
+    const int scoreDrop = _iterations > 0 ? _previousScore - score : 0;
+    _previousScore = score;
+    _iterations++;
+
+    _previousIterationMs = _lastIterationMs;
+    _lastIterationMs = elapsedMs - _lastIterationEndMs;
+    _lastIterationEndMs = elapsedMs;
+
+    // a best move that keeps changing needs more time to settle, one that has held for
+    // several iterations is unlikely to change now
+    static const int stabilityPercent[] = { 140, 110, 90, 75, 60 };
+    int percent = stabilityPercent[std::min(_stableIterations, 4)];
+    // a falling score means trouble was found, up to double the time to find a way out
+    percent = percent * (100 + std::clamp(scoreDrop, 0, 100)) / 100;
+
+    const int target = std::min(_hardMs, _softMs * percent / 100);
+    if (elapsedMs >= target) {
+        return true;
+    }
+
+    // each iteration takes a few times longer than the last, so one that cannot finish inside
+    // the hard limit would only throw its time away
+    int growth = _previousIterationMs > 0 ? _lastIterationMs / std::max(_previousIterationMs, 1) : 2;
+    growth = std::clamp(growth, 2, 4);
+    return elapsedMs + _lastIterationMs * growth > _hardMs;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "BitBoard.h"
+
+//
+// turns a clock into per-move time for the search. Each move gets a soft limit, the time it
+// should take, and a hard limit it must never pass. The soft limit stretches while the best
+// move keeps changing or the score is falling and shrinks once the best move has settled, and
+// an iteration that would overrun the hard limit is not started
+//
+
+// The clock for the side to move; everything in milliseconds
+struct TimeControl
+{
+    int         timeLeftMs = 0;         // 0 = no clock
+    int         incrementMs = 0;        // added after every move
+    int         movesToGo = 0;          // moves until the next time control, 0 = rest of the game
+};
+
+class TimeManager
+{
+public:
+    // Sets the limits for a new search, with nothing on the clock there are none
+    void start(const TimeControl& clock);
+    bool active() const { return _active; }
+
+    // Checked while an iteration runs
+    bool hardLimitReached(int elapsedMs) const { return _active && elapsedMs >= _hardMs; }
+
+    // Called after every completed iteration, true if the search should stop rather than
+    // start the next one
+    bool iterationDone(const BitMove& bestMove, int score, int elapsedMs);
+
+    int softMs() const { return _softMs; }
+    int hardMs() const { return _hardMs; }
+
+private:
+    bool        _active = false;
+    int         _softMs = 0;
+    int         _hardMs = 0;
+
+    BitMove     _bestMove{};
+    int         _stableIterations = 0;  // iterations in a row that kept the same best move
+    int         _previousScore = 0;
+    int         _iterations = 0;
+    int         _lastIterationEndMs = 0;
+    int         _lastIterationMs = 0;
+    int         _previousIterationMs = 0;
+};
@@ -0,0 +1,101 @@
+#include "TranspositionTable.h"
+#include <algorithm>
+#include <climits>
+
+void TranspositionTable::resize(int megabytes)
+{
+    size_t count = 1;
+    while (count * 2 * sizeof(Bucket) <= size_t(megabytes) * 1024 * 1024) {
+        count *= 2;
+    }
+    // release the old table first so the two are never held at once
+    _buckets = std::vector<Bucket>();
+    _buckets = std::vector<Bucket>(count);
+    _mask = count - 1;
+    _megabytes = megabytes;
+    _generation = 0;
+}
+
+void TranspositionTable::clear()
+{
+    for (Bucket& bucket : _buckets) {
+        for (Entry& entry : bucket.entries) {
+            entry.check.store(0, std::memory_order_relaxed);
+            entry.data.store(0, std::memory_order_relaxed);
+        }
+    }
+    _generation = 0;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTData& result) const
+{
+    const Bucket& bucket = _buckets[key & _mask];
+    for (const Entry& entry : bucket.entries) {
+        uint64_t data = entry.data.load(std::memory_order_relaxed);
+        uint64_t check = entry.check.load(std::memory_order_relaxed);
+        if ((check ^ data) == key && data) {
+            result.move = packedMove(data);
+            result.score = packedScore(data);
+            result.depth = packedDepth(data);
+            result.bound = packedBound(data);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Replacement: the position's own entry if it is already here, otherwise whichever entry is
+// worth least, counting each search of age as eight plies of depth so stale entries go first
+void TranspositionTable::store(uint64_t key, const BitMove& move, int score, int depth, Bound bound)
+{
+    // the entry keeps depth in 8 signed bits, deeper results are stored as the deepest it can hold
+    depth = std::clamp(depth, -128, 127);
+    Bucket& bucket = _buckets[key & _mask];
+    Entry* replace = &bucket.entries[0];
+    BitMove bestMove = move;
+    int worst = INT_MAX;
+
+    for (Entry& entry : bucket.entries) {
+        uint64_t data = entry.data.load(std::memory_order_relaxed);
+        uint64_t check = entry.check.load(std::memory_order_relaxed);
+        if ((check ^ data) == key && data) {
+            // a much deeper bound from this search is worth more than a shallow one
+            if (bound != BoundExact && packedGeneration(data) == _generation && depth < packedDepth(data) - 2) {
+                return;
+            }
+            // an upper bound has no best move, keep the one found earlier
+            if (bestMove == BitMove{}) {
+                bestMove = packedMove(data);
+            }
+            replace = &entry;
+            break;
+        }
+
+        int value = INT_MIN;
+        if (data) {
+            int age = (_generation - packedGeneration(data)) & GenerationMask;
+            value = packedDepth(data) - 8 * age;
+        }
+        if (value < worst) {
+            worst = value;
+            replace = &entry;
+        }
+    }
+
+    uint64_t data = pack(bestMove, score, depth, bound, _generation);
+    replace->data.store(data, std::memory_order_relaxed);
+    replace->check.store(key ^ data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const
+{
+    size_t samples = std::min<size_t>(250, _buckets.size());
+    int used = 0;
+    for (size_t i = 0; i < samples; i++) {
+        for (const Entry& entry : _buckets[i].entries) {
+            uint64_t data = entry.data.load(std::memory_order_relaxed);
+            used += data && packedGeneration(data) == _generation;
+        }
+    }
+    return int(used * 1000 / (samples * EntriesPerBucket));
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "BitBoard.h"
+
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
+
+//
+// transposition table shared by every search thread, keyed by the Zobrist hash
+// entries are packed four to a 64-byte bucket so a probe touches a single cache line,
+// and are lock-free: each entry stores (key ^ data, data), so an entry torn by two racing
+// writers fails the xor check and simply reads as a miss
+//
+
+enum Bound : uint8_t
+{
+    BoundNone,
+    BoundUpper,     // the score is at most this (no move raised alpha)
+    BoundLower,     // the score is at least this (a move failed high)
+    BoundExact
+};
+
+// What a probe hands back
+struct TTData
+{
+    BitMove     move;
+    int         score;
+    int         depth;
+    Bound       bound;
+};
+
+class TranspositionTable
+{
+public:
+    explicit TranspositionTable(int megabytes = 16) { resize(megabytes); }
+
+    // Reallocates to the largest power-of-two bucket count that fits, dropping every entry
+    void resize(int megabytes);
+    // Wipes every entry in place, for a new game; only call while no search is running
+    void clear();
+    int sizeMB() const { return _megabytes; }
+
+    // Called once per search so entries from older searches are replaced first
+    void newSearch() { _generation = (_generation + 1) & GenerationMask; }
+
+    bool probe(uint64_t key, TTData& data) const;
+    void store(uint64_t key, const BitMove& move, int score, int depth, Bound bound);
+
+    // Pulls the bucket for key towards the cache, so it has arrived by the time the
+    // search probes it; issued as soon as a move is made
+    void prefetch(uint64_t key) const {
+#if defined(_MSC_VER)
+        _mm_prefetch((const char*)&_buckets[key & _mask], _MM_HINT_T0);
+#else
+        __builtin_prefetch(&_buckets[key & _mask]);
+#endif
+    }
+
+    // Permille of entries written by the current search, sampled from the first buckets
+    int hashfull() const;
+
+private:
+    static constexpr int EntriesPerBucket = 4;
+    static constexpr uint8_t GenerationMask = 63;
+
+    // data layout, low to high: move (32 bits), score (16), depth (8), bound (2), generation (6)
+    struct Entry {
+        std::atomic<uint64_t>   check{0};   // key ^ data
+        std::atomic<uint64_t>   data{0};
+    };
+    struct alignas(64) Bucket {
+        Entry   entries[EntriesPerBucket];
+    };
+
+    static uint64_t pack(const BitMove& move, int score, int depth, Bound bound, uint8_t generation) {
+        uint32_t moveBits;
+        memcpy(&moveBits, &move, sizeof(moveBits));
+        return uint64_t(moveBits) | (uint64_t(uint16_t(int16_t(score))) << 32) | (uint64_t(uint8_t(depth)) << 48)
+             | (uint64_t(bound) << 56) | (uint64_t(generation) << 58);
+    }
+    static BitMove packedMove(uint64_t data) {
+        uint32_t moveBits = uint32_t(data);
+        BitMove move;
+        memcpy(&move, &moveBits, sizeof(move));
+        return move;
+    }
+    static int packedScore(uint64_t data) { return int16_t(uint16_t(data >> 32)); }
+    static int packedDepth(uint64_t data) { return int8_t(uint8_t(data >> 48)); }
+    static Bound packedBound(uint64_t data) { return Bound((data >> 56) & 3); }
+    static uint8_t packedGeneration(uint64_t data) { return uint8_t(data >> 58); }
+
+    std::vector<Bucket>     _buckets;
+    uint64_t                _mask = 0;
+    int                     _megabytes = 0;
+    uint8_t                 _generation = 0;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+
+//
+// Zobrist hashing keys, generated at compile time so they are identical in every
+// build and every thread without any runtime initialization
+//
+
+struct ZobristKeys {
+    uint64_t    pieceSquare[2][7][64];  // [color][ChessPiece][square]
+    uint64_t    castling[16];           // indexed by the full CastlingRights mask
+    uint64_t    enPassant[8];           // by file of the en passant square
+    uint64_t    side;                   // xored in when black is to move
+};
+
+constexpr uint64_t splitMix64(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+constexpr ZobristKeys makeZobristKeys()
+{
+    ZobristKeys keys{};
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+
+    for (int color = 0; color < 2; color++) {
+        for (int piece = 0; piece < 7; piece++) {
+            for (int square = 0; square < 64; square++) {
+                keys.pieceSquare[color][piece][square] = splitMix64(state);
+            }
+        }
+    }
+    // each right gets one key and a mask hashes to the xor of its rights,
+    // so clearing a single right always changes the key the same way
+    uint64_t rightKeys[4] = { splitMix64(state), splitMix64(state), splitMix64(state), splitMix64(state) };
+    for (int rights = 0; rights < 16; rights++) {
+        keys.castling[rights] = 0;
+        for (int bit = 0; bit < 4; bit++) {
+            if (rights & (1 << bit)) {
+                keys.castling[rights] ^= rightKeys[bit];
+            }
+        }
+    }
+    for (int file = 0; file < 8; file++) {
+        keys.enPassant[file] = splitMix64(state);
+    }
+    keys.side = splitMix64(state);
+    return keys;
+}
+
+inline constexpr ZobristKeys Zobrist = makeZobristKeys();
@@ -0,0 +1,224 @@
+// Search benchmark: time to reach a fixed depth over a set of positions
+//
+// usage: chess_bench [options]
+//   --depth <D>     depth every position is searched to (default 7)
+//   --threads <N>   most threads to try, the run doubles from 1 up to N (0 = every core, the default)
+//   --hash <MB>     transposition table size (default 64), cleared before every position
+//   --features      on one thread, compare the selective search features instead
+//   --nnue <file>   evaluate with this network instead of the hand-written evaluation
+//   --kernels <k>   network kernels, "scalar", "sse4.1" or "avx2" (default: chosen from CPUID)
+//
+// prints the time, nodes and nodes/sec for each thread count, the time-to-depth speedup
+// over one thread, how often the pawn table already held the structure and how full the
+// transposition table was at the end of each search, on average; with --features, the
+// nodes to reach the depth with every feature on, each one switched off in turn, and all of
+// them off. With a network, every kernel set the CPU runs first has to agree with the
+// scalar one on each position and the position after each of its moves
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include "classes/Search.h"
+
+// Openings, middlegames and endgames, quiet and tactical
+static const char* benchFENs[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "2r3k1/pp3ppp/2n1b3/3p4/3P4/2PB1N2/P4PPP/R5K1 w - - 0 20",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "8/8/4k3/3p4/3P4/4K3/8/8 w - - 0 1",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+};
+
+struct BenchRun {
+    int         threads;
+    double      seconds;
+    uint64_t    nodes;
+    uint64_t    pawnProbes;
+    uint64_t    pawnHits;
+    int         hashfull;       // permille, summed over the positions
+};
+
+static Network network;
+
+// Evaluations of every bench position, refreshed, and of each move from it, updated
+static std::vector<int> networkEvaluations()
+{
+    std::vector<int> scores;
+    Accumulator root, child;
+    for (const char* fen : benchFENs) {
+        Position position;
+        position.setFEN(fen);
+        network.refresh(position, root);
+        scores.push_back(network.evaluate(root, position.sideToMove));
+
+        MoveList moves;
+        generateLegalMoves(position, moves);
+        for (const BitMove& move : moves) {
+            network.update(root, child, featureDelta(position, move));
+            scores.push_back(network.evaluate(child, position.sideToMove ^ 1));
+        }
+    }
+    return scores;
+}
+
+// Compares each kernel set against the scalar one, leaves the selected set active
+static bool checkKernels()
+{
+    const char* selected = networkKernelName();
+    selectNetworkKernels("scalar");
+    const std::vector<int> expected = networkEvaluations();
+
+    bool agree = true;
+    printf("kernels: scalar");
+    for (const char* name : { "sse4.1", "avx2" }) {
+        if (!selectNetworkKernels(name)) {
+            continue;
+        }
+        const bool same = networkEvaluations() == expected;
+        printf(", %s %s", name, same ? "ok" : "MISMATCH");
+        agree = agree && same;
+    }
+    printf(" (%d evaluations)\n", int(expected.size()));
+    selectNetworkKernels(selected);
+    return agree;
+}
+
+static BenchRun runBench(TranspositionTable& table, int threads, int depth, const SearchFeatures& features = SearchFeatures())
+{
+    Search search(table, threads);
+    search.features = features;
+    search.network = network.loaded() ? &network : nullptr;
+    SearchLimits limits;
+    limits.depth = depth;
+
+    BenchRun run = { threads, 0.0, 0, 0, 0, 0 };
+    for (const char* fen : benchFENs) {
+        Position position;
+        position.setFEN(fen);
+        table.clear();
+
+        auto start = std::chrono::steady_clock::now();
+        SearchResult result = search.think(position, limits);
+        run.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        run.nodes += result.nodes;
+        run.pawnProbes += result.pawnProbes;
+        run.pawnHits += result.pawnHits;
+        run.hashfull += table.hashfull();
+    }
+    return run;
+}
+
+static void benchFeatures(TranspositionTable& table, int depth)
+{
+    struct Variant {
+        const char* name;
+        bool SearchFeatures::* feature;
+    };
+    static const Variant variants[] = {
+        { "null move", &SearchFeatures::nullMove },
+        { "late move reductions", &SearchFeatures::lateMoveReductions },
+        { "reverse futility", &SearchFeatures::reverseFutility },
+        { "futility", &SearchFeatures::futility },
+        { "late move pruning", &SearchFeatures::lateMovePruning },
+    };
+
+    printf("features                   time (s)         nodes   nodes vs all on\n");
+    auto report = [&](const char* name, const SearchFeatures& features, uint64_t allOn) {
+        BenchRun run = runBench(table, 1, depth, features);
+        printf("%-24s  %9.3f  %12llu  %15.2fx\n", name, run.seconds, (unsigned long long)run.nodes,
+               allOn ? double(run.nodes) / allOn : 1.0);
+        return run.nodes;
+    };
+
+    const uint64_t allOn = report("all on", SearchFeatures(), 0);
+    for (const Variant& variant : variants) {
+        SearchFeatures features;
+        features.*variant.feature = false;
+        char name[64];
+        snprintf(name, sizeof(name), "no %s", variant.name);
+        report(name, features, allOn);
+    }
+    SearchFeatures none;
+    for (const Variant& variant : variants) {
+        none.*variant.feature = false;
+    }
+    report("all off", none, allOn);
+}
+
+int main(int argc, char** argv)
+{
+    int depth = 7;
+    int maxThreads = 0;
+    int hashMB = 64;
+    bool features = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--depth") && i + 1 < argc) {
+            depth = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            maxThreads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--hash") && i + 1 < argc) {
+            hashMB = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--features")) {
+            features = true;
+        } else if (!strcmp(argv[i], "--nnue") && i + 1 < argc) {
+            if (!network.load(argv[++i])) {
+                printf("cannot load network %s\n", argv[i]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--kernels") && i + 1 < argc) {
+            i++;
+            if (!selectNetworkKernels(argv[i])) {
+                printf("network kernels %s are not available in this build or on this CPU\n", argv[i]);
+                return 1;
+            }
+        } else {
+            printf("usage: chess_bench [--depth D] [--threads N] [--hash MB] [--features] [--nnue FILE] [--kernels scalar|sse4.1|avx2]\n");
+            return 1;
+        }
+    }
+    if (maxThreads <= 0) {
+        maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    TranspositionTable table(hashMB);
+    printf("depth %d, %d positions, %d MB hash\n", depth, int(std::size(benchFENs)), hashMB);
+    if (network.loaded()) {
+        printf("network: %d hidden, %s kernels\n", network.hiddenSize(), networkKernelName());
+        if (!checkKernels()) {
+            return 1;
+        }
+    }
+    printf("\n");
+    if (features) {
+        benchFeatures(table, depth);
+        return 0;
+    }
+    printf("threads      time (s)         nodes          nps   speedup   pawn hits   hash full\n");
+
+    double baseline = 0.0;
+    for (int threads : threadCounts) {
+        BenchRun run = runBench(table, threads, depth);
+        if (threads == 1) {
+            baseline = run.seconds;
+        }
+        printf("%7d  %12.3f  %12llu  %11.0f  %7.2fx  %9.1f%%  %9.1f%%\n", run.threads, run.seconds, (unsigned long long)run.nodes,
+               run.seconds > 0 ? run.nodes / run.seconds : 0.0, run.seconds > 0 ? baseline / run.seconds : 0.0,
+               run.pawnProbes ? 100.0 * run.pawnHits / run.pawnProbes : 0.0,
+               run.hashfull / (10.0 * std::size(benchFENs)));
+    }
+    return 0;
+}
@@ -0,0 +1,241 @@
+// Perft / divide benchmark for the headless move generator
+//
+// usage: chess_perft [options] <depth> [fen]
+//   --bulk          count the moves at depth 1 instead of making them (bulk counting)
+//   --hash <MB>     reuse subtree counts through a shared hash table of this size
+//   --threads <N>   split the root moves across N threads (0 = every core)
+//   --sliders <b>   slider attack backend, "pext" or "magic" (default: chosen from CPUID)
+//   --verify        run the standard perft suite and compare against known counts
+//
+// prints the divide (nodes under each root move), the total and nodes/sec
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include "classes/MoveGen.h"
+#include "classes/Attacks.h"
+
+static const char* startFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+struct PerftOptions {
+    bool    bulk = false;
+    int     hashMB = 0;
+    int     threads = 1;
+};
+
+//
+// lock-free subtree count cache shared by every thread
+// each slot stores (key ^ data, data); a slot torn by a racing write fails the xor check
+// and simply reads as a miss, so no locks are needed
+//
+class PerftHash {
+public:
+    explicit PerftHash(int megabytes) {
+        size_t count = 1;
+        while (count * 2 * sizeof(Slot) <= size_t(megabytes) * 1024 * 1024) {
+            count *= 2;
+        }
+        _slots = std::vector<Slot>(count);
+        _mask = count - 1;
+    }
+
+    bool probe(uint64_t key, int depth, uint64_t& nodes) const {
+        const Slot& slot = _slots[key & _mask];
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        uint64_t check = slot.check.load(std::memory_order_relaxed);
+        if ((check ^ data) == key && int(data & 0xFF) == depth) {
+            nodes = data >> 8;
+            return true;
+        }
+        return false;
+    }
+
+    void store(uint64_t key, int depth, uint64_t nodes) {
+        Slot& slot = _slots[key & _mask];
+        uint64_t data = (nodes << 8) | uint64_t(depth);
+        slot.data.store(data, std::memory_order_relaxed);
+        slot.check.store(key ^ data, std::memory_order_relaxed);
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t>   check{0};
+        std::atomic<uint64_t>   data{0};
+    };
+    std::vector<Slot>   _slots;
+    size_t              _mask;
+};
+
+static uint64_t perft(Position& position, int depth, const PerftOptions& options, PerftHash* hash)
+{
+    if (depth == 0) {
+        return 1;
+    }
+
+    uint64_t nodes = 0;
+    if (hash && hash->probe(position.key, depth, nodes)) {
+        return nodes;
+    }
+
+    MoveList moves;
+    generateLegalMoves(position, moves);
+
+    if (depth == 1 && options.bulk) {
+        return moves.size();
+    }
+
+    for (const BitMove& move : moves) {
+        UndoState undo;
+        position.makeMove(move, undo);
+        nodes += perft(position, depth - 1, options, hash);
+        position.unmakeMove(move, undo);
+    }
+
+    if (hash) {
+        hash->store(position.key, depth, nodes);
+    }
+    return nodes;
+}
+
+// Divide: node counts per root move, root moves handed out to the worker threads one at a time
+static uint64_t divide(const Position& root, int depth, const PerftOptions& options, bool print)
+{
+    MoveList rootMoves;
+    generateLegalMoves(root, rootMoves);
+
+    PerftHash* hash = options.hashMB > 0 ? new PerftHash(options.hashMB) : nullptr;
+    std::vector<uint64_t> counts(rootMoves.size(), 0);
+    std::atomic<int> nextMove{0};
+
+    auto worker = [&]() {
+        Position position = root;
+        int index;
+        while ((index = nextMove.fetch_add(1)) < rootMoves.size()) {
+            UndoState undo;
+            position.makeMove(rootMoves[index], undo);
+            counts[index] = depth > 1 ? perft(position, depth - 1, options, hash) : 1;
+            position.unmakeMove(rootMoves[index], undo);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < options.threads; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    delete hash;
+
+    uint64_t total = 0;
+    for (int i = 0; i < rootMoves.size(); i++) {
+        if (print) {
+            printf("%s: %llu\n", moveToString(rootMoves[i]).c_str(), (unsigned long long)counts[i]);
+        }
+        total += counts[i];
+    }
+    return total;
+}
+
+static int verify(const PerftOptions& options)
+{
+    struct PerftCase {
+        const char* fen;
+        int         depth;
+        uint64_t    nodes;
+    };
+    const PerftCase cases[] = {
+        { startFEN, 5, 4865609 },
+        { "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603 },
+        { "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6, 11030083 },
+        { "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5, 15833292 },
+        { "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487 },
+        { "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594 },
+    };
+
+    int failures = 0;
+    for (const PerftCase& c : cases) {
+        Position position;
+        position.setFEN(c.fen);
+        uint64_t nodes = divide(position, c.depth, options, false);
+        bool ok = nodes == c.nodes;
+        failures += !ok;
+        printf("%s depth %d: %llu (expected %llu) %s\n", ok ? "ok  " : "FAIL", c.depth,
+               (unsigned long long)nodes, (unsigned long long)c.nodes, c.fen);
+    }
+    return failures ? 1 : 0;
+}
+
+static void usage()
+{
+    printf("usage: chess_perft [--bulk] [--hash MB] [--threads N] [--sliders pext|magic] <depth> [fen]\n");
+    printf("       chess_perft [--bulk] [--hash MB] [--threads N] [--sliders pext|magic] --verify\n");
+}
+
+int main(int argc, char** argv)
+{
+    PerftOptions options;
+    int depth = 0;
+    bool runVerify = false;
+    std::string fen;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--bulk")) {
+            options.bulk = true;
+        } else if (!strcmp(argv[i], "--hash") && i + 1 < argc) {
+            options.hashMB = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            options.threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--sliders") && i + 1 < argc) {
+            i++;
+            if (!selectSliderBackend(!strcmp(argv[i], "pext"))) {
+                printf("slider backend %s is not available in this build or on this CPU\n", argv[i]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--verify")) {
+            runVerify = true;
+        } else if (depth == 0) {
+            depth = atoi(argv[i]);
+        } else {
+            // the FEN may arrive as one argument or split on its spaces
+            if (!fen.empty()) {
+                fen += ' ';
+            }
+            fen += argv[i];
+        }
+    }
+    if (options.threads <= 0) {
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    printf("sliders: %s\n", sliderBackendName());
+    if (runVerify) {
+        return verify(options);
+    }
+    if (depth <= 0) {
+        usage();
+        return 1;
+    }
+
+    Position position;
+    if (!position.setFEN(fen.empty() ? startFEN : fen)) {
+        printf("invalid FEN: %s\n", fen.c_str());
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t nodes = divide(position, depth, options, true);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("\nnodes: %llu\n", (unsigned long long)nodes);
+    printf("time: %.3f s\n", seconds);
+    printf("nps: %.0f\n", seconds > 0 ? nodes / seconds : 0.0);
+    return 0;
+}
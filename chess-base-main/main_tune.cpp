@@ -0,0 +1,706 @@
+// Texel tuner for the hand-written evaluation
+//
+// usage: chess_tune [options] <positions file>
+//   --epochs <N>    passes of gradient descent over every position (default 500)
+//   --rate <R>      Adam step size, in centipawns (default 1.0)
+//   --threads <N>   threads for loading and tuning (0 = every core, the default)
+//   --out <file>    where to write the tuned weights (default EvalWeights.tuned.h)
+//
+// each line of the positions file is a FEN followed by the game's result for white, either as
+// "1-0", "0-1" and "1/2-1/2" or as a number such as [0.5] or 1.0; lines that do not parse or
+// hold an illegal position are skipped. The file is memory-mapped and split between the
+// threads, which resolve every position to a quiet one with a quiescence search and reduce it
+// to how often each evaluation weight applies. The evaluation is linear in its weights apart
+// from the tapering and scaling, so from then on an epoch is a pass over those counts: Adam
+// minimises the squared error between the game results and the sigmoid of the evaluation.
+//
+// the output has the layout of classes/EvalWeights.h and replaces it as it is
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include "classes/Evaluate.h"
+#include "classes/MovePicker.h"
+#include "classes/Search.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//
+// read-only view of a whole file
+//
+class MappedFile {
+public:
+    ~MappedFile() { close(); }
+
+    bool open(const char* path) {
+#ifdef _WIN32
+        _file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (_file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0) {
+            return false;
+        }
+        _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!_mapping) {
+            return false;
+        }
+        _data = static_cast<const char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+        _size = size_t(size.QuadPart);
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* data = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        // read front to back once, by several threads
+        madvise(data, size_t(info.st_size), MADV_SEQUENTIAL);
+        _data = static_cast<const char*>(data);
+        _size = size_t(info.st_size);
+#endif
+        return _data != nullptr;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (_data) {
+            UnmapViewOfFile(_data);
+        }
+        if (_mapping) {
+            CloseHandle(_mapping);
+        }
+        if (_file != INVALID_HANDLE_VALUE) {
+            CloseHandle(_file);
+        }
+        _mapping = nullptr;
+        _file = INVALID_HANDLE_VALUE;
+#else
+        if (_data) {
+            munmap(const_cast<char*>(_data), _size);
+        }
+#endif
+        _data = nullptr;
+        _size = 0;
+    }
+
+    const char* data() const { return _data; }
+    size_t size() const { return _size; }
+
+private:
+    const char* _data = nullptr;
+    size_t      _size = 0;
+#ifdef _WIN32
+    HANDLE      _file = INVALID_HANDLE_VALUE;
+    HANDLE      _mapping = nullptr;
+#endif
+};
+
+//
+// every weight of EvalWeights.h, as terms that each have a midgame and an endgame weight
+//
+constexpr int TermMaterial = 0;                         // MidgameValue / EndgameValue, pawn to queen
+constexpr int TermTable = TermMaterial + 5;             // MidgameTable / EndgameTable [piece - 1][index], pawn to king
+constexpr int TermDoubled = TermTable + 6 * 64;
+constexpr int TermIsolated = TermDoubled + 1;
+constexpr int TermBackward = TermIsolated + 1;
+constexpr int TermPassed = TermBackward + 1;            // PassedPawnMidgame / PassedPawnEndgame [rank]
+constexpr int TermKingShield = TermPassed + 8;          // midgame only
+constexpr int TermImbalance = TermKingShield + 1;       // [ImbalanceTerm]
+constexpr int TermCount = TermImbalance + ImbalanceTermCount;
+
+struct Weights {
+    double      midgame[TermCount];
+    double      endgame[TermCount];
+};
+
+static Weights currentWeights()
+{
+    Weights weights{};
+    auto set = [&weights](int term, double midgame, double endgame) {
+        weights.midgame[term] = midgame;
+        weights.endgame[term] = endgame;
+    };
+    for (int piece = Pawn; piece <= Queen; piece++) {
+        set(TermMaterial + piece - Pawn, MidgameValue[piece], EndgameValue[piece]);
+    }
+    for (int piece = Pawn; piece <= King; piece++) {
+        for (int index = 0; index < 64; index++) {
+            set(TermTable + (piece - Pawn) * 64 + index, MidgameTable[piece][index], EndgameTable[piece][index]);
+        }
+    }
+    set(TermDoubled, DoubledPawn[0], DoubledPawn[1]);
+    set(TermIsolated, IsolatedPawn[0], IsolatedPawn[1]);
+    set(TermBackward, BackwardPawn[0], BackwardPawn[1]);
+    for (int rank = 0; rank < 8; rank++) {
+        set(TermPassed + rank, PassedPawnMidgame[rank], PassedPawnEndgame[rank]);
+    }
+    set(TermKingShield, KingShieldPawn, 0);
+    set(TermImbalance + ImbalanceKnightPawns, KnightPawnAdjust[0], KnightPawnAdjust[1]);
+    set(TermImbalance + ImbalanceRookPawns, RookPawnAdjust[0], RookPawnAdjust[1]);
+    set(TermImbalance + ImbalanceBishopPair, BishopPair[0], BishopPair[1]);
+    set(TermImbalance + ImbalanceRedundantRook, RedundantRook[0], RedundantRook[1]);
+    set(TermImbalance + ImbalanceQueenRook, QueenRook[0], QueenRook[1]);
+    return weights;
+}
+
+//
+// the training set: for each quiet position, how many times white's side of each term
+// applies less black's side
+//
+struct Coefficient {
+    uint16_t    term;
+    int16_t     count;
+};
+
+struct Sample {
+    uint32_t    first;          // into the batch's coefficients
+    uint16_t    count;
+    uint8_t     phase;
+    uint8_t     scale[2];       // the material table's endgame scale when white or black is ahead
+    float       result;         // 1 white won, 0.5 draw, 0 black won
+};
+
+// One thread's share of the positions
+struct Batch {
+    std::vector<Sample>         samples;
+    std::vector<Coefficient>    coefficients;
+    uint64_t                    lines = 0;
+    uint64_t                    skipped = 0;
+    int                         largestMismatch = 0;    // model against evaluate(), with the starting weights
+};
+
+// Evaluation from white's side, as evaluate() computes it
+static double modelEval(const Batch& batch, const Sample& sample, const Weights& weights, double& midgame, double& endgame)
+{
+    midgame = 0.0;
+    endgame = 0.0;
+    const Coefficient* coefficient = &batch.coefficients[sample.first];
+    for (int i = 0; i < sample.count; i++, coefficient++) {
+        midgame += coefficient->count * weights.midgame[coefficient->term];
+        endgame += coefficient->count * weights.endgame[coefficient->term];
+    }
+    const double scale = sample.scale[endgame > 0 ? White : Black] / double(ScaleNormal);
+    return (midgame * sample.phase + endgame * scale * (MaxPhase - sample.phase)) / MaxPhase;
+}
+
+//
+// loading
+//
+
+static const HistoryTable noHistory = {};
+constexpr int MaxQuiescencePly = 32;
+
+struct LoadTables {
+    PawnTable       pawns;
+    MaterialTable   material;
+};
+
+// Captures-only search like the engine's, returns the score and the quiet position at the
+// end of its principal variation in leaf
+static int quiescence(const Position& position, int alpha, int beta, int ply, Position& leaf, LoadTables& tables)
+{
+    const bool inCheck = position.inCheck();
+    leaf = position;
+    int best = -ScoreInfinite;
+    if (!inCheck) {
+        best = evaluate(position, &tables.pawns, &tables.material);
+        if (best >= beta || ply >= MaxQuiescencePly) {
+            return best;
+        }
+        alpha = std::max(alpha, best);
+    }
+
+    MovePicker picker(position, BitMove{}, noHistory);
+    Position child;
+    Position childLeaf;
+    for (BitMove move = picker.next(); move != BitMove{}; move = picker.next()) {
+        child = position;
+        UndoState undo;
+        child.makeMove(move, undo);
+        const int score = -quiescence(child, -beta, -alpha, ply + 1, childLeaf, tables);
+        if (score > best) {
+            best = score;
+            if (score > alpha) {
+                alpha = score;
+                leaf = childLeaf;
+            }
+            if (score >= beta) {
+                break;
+            }
+        }
+    }
+    if (inCheck && best == -ScoreInfinite) {
+        return -ScoreMate + ply;
+    }
+    return best;
+}
+
+// Game result after the FEN: "1-0", "0-1", "1/2-1/2" or a number, optionally bracketed or quoted
+static bool parseResult(std::string_view text, float& result)
+{
+    if (text.find("1/2") != std::string_view::npos) {
+        result = 0.5f;
+        return true;
+    }
+    if (text.find("1-0") != std::string_view::npos) {
+        result = 1.0f;
+        return true;
+    }
+    if (text.find("0-1") != std::string_view::npos) {
+        result = 0.0f;
+        return true;
+    }
+    size_t start = text.find_first_of("0123456789.");
+    if (start == std::string_view::npos) {
+        return false;
+    }
+    std::string number(text.substr(start, text.find_first_not_of("0123456789.", start) - start));
+    char* end;
+    double value = strtod(number.c_str(), &end);
+    if (end == number.c_str() || value < 0.0 || value > 1.0) {
+        return false;
+    }
+    result = float(value);
+    return true;
+}
+
+// Splits a line into the FEN, four fields plus the two counters if they are there, and the rest
+static bool splitLine(std::string_view line, std::string_view& fen, std::string_view& rest)
+{
+    size_t end = 0;
+    for (int field = 0; field < 6; field++) {
+        size_t start = line.find_first_not_of(' ', end);
+        if (start == std::string_view::npos) {
+            break;
+        }
+        size_t stop = std::min(line.find(' ', start), line.size());
+        std::string_view token = line.substr(start, stop - start);
+        if (field >= 4 && token.find_first_not_of("0123456789") != std::string_view::npos) {
+            break;
+        }
+        end = stop;
+    }
+    fen = line.substr(0, end);
+    rest = line.substr(end);
+    return !fen.empty();
+}
+
+// Adds the counts behind evaluate(position), from white's side, to the batch
+static void addSample(const Position& position, float result, Batch& batch)
+{
+    int counts[TermCount] = {};
+    for (int color = White; color <= Black; color++) {
+        const int sign = color == White ? 1 : -1;
+        for (int piece = Pawn; piece <= King; piece++) {
+            for (uint64_t bits = position.pieces[color][piece]; bits; bits &= bits - 1) {
+                const int square = std::countr_zero(bits);
+                // the same mapping as PieceSquare.h
+                const int index = color == White ? square ^ 56 : square;
+                counts[TermTable + (piece - Pawn) * 64 + index] += sign;
+                if (piece != King) {
+                    counts[TermMaterial + piece - Pawn] += sign;
+                }
+            }
+        }
+    }
+
+    PawnEntry pawns;
+    PawnTerms pawnTerms;
+    analysePawns(position, pawns, &pawnTerms);
+    for (int color = White; color <= Black; color++) {
+        const int sign = color == White ? 1 : -1;
+        counts[TermDoubled] += sign * pawnTerms.doubled[color];
+        counts[TermIsolated] += sign * pawnTerms.isolated[color];
+        counts[TermBackward] += sign * pawnTerms.backward[color];
+        for (int rank = 0; rank < 8; rank++) {
+            counts[TermPassed + rank] += sign * pawnTerms.passed[color][rank];
+        }
+
+        int imbalance[ImbalanceTermCount];
+        imbalanceTerms(position.materialKey, color, imbalance);
+        for (int term = 0; term < ImbalanceTermCount; term++) {
+            counts[TermImbalance + term] += sign * imbalance[term];
+        }
+    }
+    counts[TermKingShield] = kingShieldPawns(position, pawns);
+
+    MaterialEntry material;
+    analyseMaterial(position, material);
+
+    Sample sample;
+    sample.first = uint32_t(batch.coefficients.size());
+    sample.count = 0;
+    sample.phase = uint8_t(std::min(int(position.phase), MaxPhase));
+    sample.scale[White] = uint8_t(material.scale(position, White));
+    sample.scale[Black] = uint8_t(material.scale(position, Black));
+    sample.result = result;
+    for (int term = 0; term < TermCount; term++) {
+        if (counts[term]) {
+            batch.coefficients.push_back({ uint16_t(term), int16_t(counts[term]) });
+            sample.count++;
+        }
+    }
+    batch.samples.push_back(sample);
+
+    // the model has to agree with the engine up to the rounding of its integer arithmetic
+    static const Weights starting = currentWeights();
+    double midgame, endgame;
+    const double model = modelEval(batch, sample, starting, midgame, endgame);
+    const int engine = evaluate(position) * (position.sideToMove == White ? 1 : -1);
+    batch.largestMismatch = std::max(batch.largestMismatch, int(std::abs(model - engine)));
+}
+
+static void loadBatch(const char* begin, const char* end, Batch& batch)
+{
+    LoadTables tables;
+    Position position;
+    Position leaf;
+    while (begin < end) {
+        const char* newline = static_cast<const char*>(memchr(begin, '\n', end - begin));
+        const char* lineEnd = newline ? newline : end;
+        std::string_view line(begin, lineEnd - begin);
+        begin = lineEnd + 1;
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+        batch.lines++;
+
+        std::string_view fen, rest;
+        float result;
+        if (!splitLine(line, fen, rest) || !parseResult(rest, result) || !position.setFEN(fen)) {
+            batch.skipped++;
+            continue;
+        }
+        const int score = quiescence(position, -ScoreInfinite, ScoreInfinite, 0, leaf, tables);
+        // mates and known endgames do not depend on the weights
+        if (std::abs(score) >= ScoreMateInMaxPly || leaf.inCheck() || tables.material.probe(leaf).evaluator) {
+            batch.skipped++;
+            continue;
+        }
+        addSample(leaf, result, batch);
+    }
+}
+
+//
+// tuning
+//
+
+// Runs work(batch index) on one thread per batch
+template <typename Work>
+static void forEachBatch(std::vector<Batch>& batches, Work work)
+{
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < batches.size(); i++) {
+        threads.emplace_back(work, i);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+static double sigmoid(double k, double eval)
+{
+    return 1.0 / (1.0 + std::exp(-k * eval));
+}
+
+static double meanError(std::vector<Batch>& batches, const Weights& weights, double k)
+{
+    std::vector<double> errors(batches.size());
+    forEachBatch(batches, [&](size_t i) {
+        double error = 0.0;
+        for (const Sample& sample : batches[i].samples) {
+            double midgame, endgame;
+            const double difference = sample.result - sigmoid(k, modelEval(batches[i], sample, weights, midgame, endgame));
+            error += difference * difference;
+        }
+        errors[i] = error;
+    });
+    size_t samples = 0;
+    double error = 0.0;
+    for (size_t i = 0; i < batches.size(); i++) {
+        samples += batches[i].samples.size();
+        error += errors[i];
+    }
+    return error / double(samples);
+}
+
+// The sigmoid scale that fits the starting weights best, by golden section search
+static double fitScale(std::vector<Batch>& batches, const Weights& weights)
+{
+    const double ratio = (std::sqrt(5.0) - 1.0) / 2.0;
+    double low = 0.0005;
+    double high = 0.02;
+    for (int step = 0; step < 30; step++) {
+        const double a = high - ratio * (high - low);
+        const double b = low + ratio * (high - low);
+        if (meanError(batches, weights, a) < meanError(batches, weights, b)) {
+            high = b;
+        } else {
+            low = a;
+        }
+    }
+    return (low + high) / 2.0;
+}
+
+// Gradient of the mean squared error over every sample
+static void gradient(std::vector<Batch>& batches, const Weights& weights, double k, Weights& total)
+{
+    std::vector<Weights> partial(batches.size());
+    forEachBatch(batches, [&](size_t i) {
+        Weights& sum = partial[i];
+        sum = Weights{};
+        const Batch& batch = batches[i];
+        for (const Sample& sample : batch.samples) {
+            double midgame, endgame;
+            const double predicted = sigmoid(k, modelEval(batch, sample, weights, midgame, endgame));
+            // d(error)/d(eval), then how much of the eval each stage's weights make up
+            const double slope = -2.0 * (sample.result - predicted) * predicted * (1.0 - predicted) * k;
+            const double scale = sample.scale[endgame > 0 ? White : Black] / double(ScaleNormal);
+            const double midgameSlope = slope * sample.phase / MaxPhase;
+            const double endgameSlope = slope * scale * (MaxPhase - sample.phase) / MaxPhase;
+            const Coefficient* coefficient = &batch.coefficients[sample.first];
+            for (int c = 0; c < sample.count; c++, coefficient++) {
+                sum.midgame[coefficient->term] += midgameSlope * coefficient->count;
+                sum.endgame[coefficient->term] += endgameSlope * coefficient->count;
+            }
+        }
+    });
+
+    size_t samples = 0;
+    total = Weights{};
+    for (size_t i = 0; i < batches.size(); i++) {
+        samples += batches[i].samples.size();
+        for (int term = 0; term < TermCount; term++) {
+            total.midgame[term] += partial[i].midgame[term];
+            total.endgame[term] += partial[i].endgame[term];
+        }
+    }
+    for (int term = 0; term < TermCount; term++) {
+        total.midgame[term] /= double(samples);
+        total.endgame[term] /= double(samples);
+    }
+    // the king shield has no endgame weight
+    total.endgame[TermKingShield] = 0.0;
+}
+
+//
+// output
+//
+
+static int rounded(double weight)
+{
+    return int(std::lround(std::clamp(weight, -32768.0, 32767.0)));
+}
+
+static void writeArray(FILE* file, const char* name, const double* values, int count)
+{
+    fprintf(file, "constexpr int16_t %s[%d] = { ", name, count);
+    for (int i = 0; i < count; i++) {
+        fprintf(file, "%s%d", i ? ", " : "", rounded(values[i]));
+    }
+    fprintf(file, " };\n");
+}
+
+static void writeTable(FILE* file, const char* name, const double* weights)
+{
+    static const char* pieceNames[] = { "pawn", "knight", "bishop", "rook", "queen", "king" };
+    fprintf(file, "constexpr int16_t %s[7][64] = {\n    {},\n", name);
+    for (int piece = Pawn; piece <= King; piece++) {
+        fprintf(file, "    // %s\n", pieceNames[piece - Pawn]);
+        for (int index = 0; index < 64; index++) {
+            fprintf(file, "%s%4d%s", index == 0 ? "    {" : index % 8 == 0 ? "     " : "",
+                    rounded(weights[TermTable + (piece - Pawn) * 64 + index]),
+                    index == 63 ? " },\n" : index % 8 == 7 ? ",\n" : ",");
+        }
+    }
+    fprintf(file, "};\n");
+}
+
+// Writes weights in the layout of EvalWeights.h
+static bool writeWeights(const char* path, const Weights& weights)
+{
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+    auto writePair = [file, &weights](const char* name, int term) {
+        const double values[2] = { weights.midgame[term], weights.endgame[term] };
+        writeArray(file, name, values, 2);
+    };
+
+    fprintf(file, "#pragma once\n\n#include <cstdint>\n\n");
+    fprintf(file, "//\n"
+                  "// hand-written evaluation weights, in centipawns\n"
+                  "// material and piece-square values for the midgame and the endgame, indexed by ChessPiece.\n"
+                  "// Tables are laid out as white sees the board in a diagram, rank 8 on the first row, and\n"
+                  "// hold placement only; PieceSquare.h adds the material and builds black's by mirroring\n"
+                  "// (tuned by chess_tune)\n"
+                  "//\n\n");
+    double midgameValues[7] = {}, endgameValues[7] = {};
+    for (int piece = Pawn; piece <= Queen; piece++) {
+        midgameValues[piece] = weights.midgame[TermMaterial + piece - Pawn];
+        endgameValues[piece] = weights.endgame[TermMaterial + piece - Pawn];
+    }
+    writeArray(file, "MidgameValue", midgameValues, 7);
+    writeArray(file, "EndgameValue", endgameValues, 7);
+    fprintf(file, "\n// How much each piece counts towards the midgame, a full set of pieces makes MaxPhase\n");
+    fprintf(file, "constexpr int PhaseWeight[7] = { 0, 0, 1, 1, 2, 4, 0 };\nconstexpr int MaxPhase = 24;\n\n");
+    writeTable(file, "MidgameTable", weights.midgame);
+    fprintf(file, "\n");
+    writeTable(file, "EndgameTable", weights.endgame);
+
+    fprintf(file, "\n// Pawn structure, per pawn: midgame then endgame\n");
+    writePair("DoubledPawn", TermDoubled);
+    writePair("IsolatedPawn", TermIsolated);
+    writePair("BackwardPawn", TermBackward);
+    fprintf(file, "// by rank counted from the pawn's own side, rank 1 first\n");
+    writeArray(file, "PassedPawnMidgame", &weights.midgame[TermPassed], 8);
+    writeArray(file, "PassedPawnEndgame", &weights.endgame[TermPassed], 8);
+    fprintf(file, "// Midgame bonus for each pawn on the three files around a king still on its first two ranks\n");
+    fprintf(file, "constexpr int16_t KingShieldPawn = %d;\n", rounded(weights.midgame[TermKingShield]));
+
+    fprintf(file, "\n// Material imbalance, midgame then endgame\n");
+    writePair("BishopPair", TermImbalance + ImbalanceBishopPair);
+    fprintf(file, "// per own pawn above or below five: knights gain from a closed board, rooks from an open one\n");
+    writePair("KnightPawnAdjust", TermImbalance + ImbalanceKnightPawns);
+    writePair("RookPawnAdjust", TermImbalance + ImbalanceRookPawns);
+    fprintf(file, "// a second rook or queen adds less than the first\n");
+    writePair("RedundantRook", TermImbalance + ImbalanceRedundantRook);
+    writePair("QueenRook", TermImbalance + ImbalanceQueenRook);
+    return fclose(file) == 0;
+}
+
+int main(int argc, char** argv)
+{
+    int epochs = 500;
+    double rate = 1.0;
+    int threadCount = 0;
+    const char* outPath = "EvalWeights.tuned.h";
+    const char* inPath = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--epochs") && i + 1 < argc) {
+            epochs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--rate") && i + 1 < argc) {
+            rate = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threadCount = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (argv[i][0] != '-' && !inPath) {
+            inPath = argv[i];
+        } else {
+            inPath = nullptr;
+            break;
+        }
+    }
+    if (!inPath) {
+        printf("usage: chess_tune [--epochs N] [--rate R] [--threads N] [--out FILE] <positions file>\n");
+        return 1;
+    }
+    if (threadCount <= 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    MappedFile file;
+    if (!file.open(inPath)) {
+        printf("cannot map %s\n", inPath);
+        return 1;
+    }
+
+    // split the file at line starts, one piece per thread
+    auto start = std::chrono::steady_clock::now();
+    std::vector<Batch> batches(threadCount);
+    std::vector<const char*> bounds(threadCount + 1);
+    const char* end = file.data() + file.size();
+    bounds[0] = file.data();
+    bounds[threadCount] = end;
+    for (int i = 1; i < threadCount; i++) {
+        const char* split = std::max(bounds[i - 1], file.data() + file.size() / threadCount * i);
+        const char* newline = static_cast<const char*>(memchr(split, '\n', end - split));
+        bounds[i] = newline ? newline + 1 : end;
+    }
+    forEachBatch(batches, [&](size_t i) { loadBatch(bounds[i], bounds[i + 1], batches[i]); });
+
+    uint64_t lines = 0, skipped = 0, samples = 0;
+    int largestMismatch = 0;
+    for (const Batch& batch : batches) {
+        lines += batch.lines;
+        skipped += batch.skipped;
+        samples += batch.samples.size();
+        largestMismatch = std::max(largestMismatch, batch.largestMismatch);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%llu positions, %llu skipped, loaded on %d threads in %.1fs\n", (unsigned long long)samples,
+           (unsigned long long)skipped, threadCount, seconds);
+    printf("model against evaluate(): largest difference %d cp\n", largestMismatch);
+    if (samples == 0) {
+        return 1;
+    }
+
+    Weights weights = currentWeights();
+    const double k = fitScale(batches, weights);
+    printf("sigmoid scale %.6f, error %.6f\n", k, meanError(batches, weights, k));
+
+    // Adam, full batch
+    const double beta1 = 0.9;
+    const double beta2 = 0.999;
+    Weights momentum{}, velocity{}, step;
+    start = std::chrono::steady_clock::now();
+    for (int epoch = 1; epoch <= epochs; epoch++) {
+        gradient(batches, weights, k, step);
+        const double correction1 = 1.0 - std::pow(beta1, epoch);
+        const double correction2 = 1.0 - std::pow(beta2, epoch);
+        auto update = [&](double* weight, double* m, double* v, const double* g) {
+            for (int term = 0; term < TermCount; term++) {
+                m[term] = beta1 * m[term] + (1.0 - beta1) * g[term];
+                v[term] = beta2 * v[term] + (1.0 - beta2) * g[term] * g[term];
+                weight[term] -= rate * (m[term] / correction1) / (std::sqrt(v[term] / correction2) + 1e-12);
+            }
+        };
+        update(weights.midgame, momentum.midgame, velocity.midgame, step.midgame);
+        update(weights.endgame, momentum.endgame, velocity.endgame, step.endgame);
+
+        if (epoch % 50 == 0 || epoch == epochs) {
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            printf("epoch %4d  error %.6f  %.1fs\n", epoch, meanError(batches, weights, k), seconds);
+            fflush(stdout);
+        }
+    }
+
+    if (!writeWeights(outPath, weights)) {
+        printf("cannot write %s\n", outPath);
+        return 1;
+    }
+    printf("weights written to %s\n", outPath);
+    return 0;
+}